@@ -0,0 +1,77 @@
+// Column scan benchmark: full-roster statistics, a mark predicate scan and a
+// sort by mark, the operations that touch one field of every record.
+//
+// Build and run from the repository root:
+//   gcc -O2 -Iinclude bench/bench_layout.c src/store.c src/stats.c src/sort.c src/markindex.c src/markscan.c src/metrics.c src/trigram.c src/progdict.c src/util.c -o bench_layout -lpthread
+//   ./bench_layout [rows]
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "sort.h"
+#include "stats.h"
+#include "store.h"
+
+#define REPEATS 5
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void fill_store(Store *s, size_t n) {
+    ProgCode prog = prog_intern("Computer Science");
+    size_t base = s->size;
+    if (!store_append_raw(s, n)) {
+        fprintf(stderr, "Out of memory for %zu rows\n", n);
+        exit(1);
+    }
+    for (size_t i = 0; i < n; i++) {
+        size_t slot = base + i;
+        s->ids[slot] = 1000000 + (int)((i * 7919u) % 90000000u);
+        char name[NAME_LEN];
+        int len = snprintf(name, sizeof name, "Student %zu", i);
+        if (!store_set_name(s, slot, name, (size_t)len)) {
+            fprintf(stderr, "Out of memory for names\n");
+            exit(1);
+        }
+        s->progs[slot] = prog;
+        s->marks[slot] = (float)((i * 37u) % 1001u) / 10.0f;
+    }
+    store_reindex(s);
+}
+
+int main(int argc, char **argv) {
+    size_t n = argc > 1 ? (size_t)strtoull(argv[1], NULL, 10) : 1000000;
+
+    Store s;
+    store_init(&s);
+    fill_store(&s, n);
+
+    volatile float sink = 0;
+    double t0 = now_sec();
+    for (int k = 0; k < REPEATS; k++) {
+        Stats st = compute_stats(s.marks, s.size);
+        sink += st.average;
+    }
+    double stats_s = (now_sec() - t0) / REPEATS;
+
+    size_t below = 0;
+    t0 = now_sec();
+    for (int k = 0; k < REPEATS; k++) {
+        for (size_t i = 0; i < s.size; i++) {
+            below += s.marks[i] < 50.0f;
+        }
+    }
+    double scan_s = (now_sec() - t0) / REPEATS;
+
+    t0 = now_sec();
+    store_sort(&s, SORT_BY_MARK, true);
+    double sort_s = now_sec() - t0;
+
+    printf("%10s %12s %12s %12s %12s\n", "rows", "stats_s", "markscan_s", "sort_s", "below_50");
+    printf("%10zu %12.4f %12.4f %12.4f %12zu\n", n, stats_s, scan_s, sort_s, below / REPEATS);
+    (void)sink;
+    store_free(&s);
+    return 0;
+}
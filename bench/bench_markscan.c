@@ -0,0 +1,117 @@
+// Mark-column kernels: checks that every kernel the CPU supports returns the
+// same statistics and filter results as the scalar one, then times each.
+//
+// Build and run from the repository root:
+//   gcc -O2 -Iinclude bench/bench_markscan.c src/markscan.c -o bench_markscan -lpthread
+//   ./bench_markscan [rows]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "markscan.h"
+
+#define REPEATS 10
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static bool same_stats(const MarkScanStats *a, const MarkScanStats *b) {
+    return memcmp(&a->sum, &b->sum, sizeof a->sum) == 0 &&
+           memcmp(&a->min, &b->min, sizeof a->min) == 0 &&
+           memcmp(&a->max, &b->max, sizeof a->max) == 0 &&
+           a->min_idx == b->min_idx && a->max_idx == b->max_idx &&
+           memcmp(a->band, b->band, sizeof a->band) == 0;
+}
+
+// Compare every supported kernel with scalar on marks[0, n) for a few ranges
+static bool cross_check(const float *marks, size_t n, int *want, int *got) {
+    static const MarkRange ranges[] = {
+        { 50.0f, 50.0f, true, true },
+        { 50.0f, INFINITY, false, true },
+        { -INFINITY, 65.0f, true, false },
+        { 74.9f, 85.0f, true, true },
+        { -INFINITY, INFINITY, true, true },
+    };
+    MarkScanStats base, other;
+    markscan_select(MARKSCAN_SCALAR);
+    markscan_stats(marks, n, &base);
+
+    for (int k = MARKSCAN_SCALAR + 1; k < MARKSCAN_KERNELS; k++) {
+        if (!markscan_select((MarkScanKernel)k)) continue;
+        markscan_stats(marks, n, &other);
+        if (!same_stats(&base, &other)) {
+            fprintf(stderr, "%s stats differ from scalar at n=%zu\n", markscan_kernel_name(k), n);
+            return false;
+        }
+        for (size_t r = 0; r < sizeof ranges / sizeof ranges[0]; r++) {
+            markscan_select(MARKSCAN_SCALAR);
+            size_t nw = markscan_filter(marks, n, ranges[r], want);
+            markscan_select((MarkScanKernel)k);
+            size_t ng = markscan_filter(marks, n, ranges[r], got);
+            if (nw != ng || memcmp(want, got, nw * sizeof *want) != 0) {
+                fprintf(stderr, "%s filter %zu differs from scalar at n=%zu\n", markscan_kernel_name(k), r, n);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    size_t n = argc > 1 ? (size_t)strtoull(argv[1], NULL, 10) : 10000000;
+    float *marks = malloc((n ? n : 1) * sizeof *marks);
+    int *want = malloc((n ? n : 1) * sizeof *want);
+    int *got = malloc((n ? n : 1) * sizeof *got);
+    if (!marks || !want || !got) {
+        fprintf(stderr, "Out of memory for %zu rows\n", n);
+        return 1;
+    }
+    unsigned x = 2463534242u;
+    for (size_t i = 0; i < n; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        marks[i] = (float)(x % 1001u) / 10.0f;
+    }
+    if (n > 40) {
+        marks[n - 3] = 0.0f;    // Ties with earlier extremes land in the tail
+        marks[n / 2] = -0.0f;
+    }
+
+    // Every length up to 40 exercises the tails, then the full column
+    for (size_t len = 1; len <= 40 && len <= n; len++) {
+        if (!cross_check(marks, len, want, got)) return 1;
+    }
+    if (!cross_check(marks, n, want, got)) return 1;
+    printf("All kernels agree with scalar on %zu rows\n", n);
+
+    printf("%8s %12s %12s\n", "kernel", "stats_ms", "filter_ms");
+    MarkRange wide = { GRADE_D_MIN, INFINITY, true, true };
+    for (int k = MARKSCAN_SCALAR; k < MARKSCAN_KERNELS; k++) {
+        if (!markscan_select((MarkScanKernel)k)) continue;
+        MarkScanStats st;
+        volatile double sink = 0;
+        double t0 = now_sec();
+        for (int r = 0; r < REPEATS; r++) {
+            markscan_stats(marks, n, &st);
+            sink += st.sum;
+        }
+        double stats_ms = (now_sec() - t0) * 1e3 / REPEATS;
+        t0 = now_sec();
+        for (int r = 0; r < REPEATS; r++) {
+            sink += (double)markscan_filter(marks, n, wide, got);
+        }
+        double filter_ms = (now_sec() - t0) * 1e3 / REPEATS;
+        printf("%8s %12.3f %12.3f\n", markscan_kernel_name(k), stats_ms, filter_ms);
+        (void)sink;
+    }
+
+    free(marks);
+    free(want);
+    free(got);
+    return 0;
+}
@@ -0,0 +1,181 @@
+// INSERT/UPDATE argument parsing benchmark: the one-pass kv_parse_student
+// against the previous parser, which searched the rest of the line for every
+// key twice per field. Lines grow with the length of the Programme value to
+// show the old cost rising with line length. Also checks both parsers agree.
+//
+// Build and run from the repository root:
+//   gcc -O2 -Iinclude bench/bench_parse.c src/kvparse.c src/progdict.c src/util.c -o bench_parse -lpthread
+//   ./bench_parse [lines]
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "kvparse.h"
+#include "util.h"
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// The parser handle_insert and handle_update used before kv_parse_student
+static char *legacy_next_key(char *p, const char **found_keyname) {
+    static const char *keys[] = {"ID", "Name", "Programme", "Mark"};
+    char *next_key_pos = NULL;
+    *found_keyname = NULL;
+    for (size_t i = 0; i < 4; i++) {
+        char *found_pos = (char *)str_icase_find(p, keys[i]);
+        if (found_pos && (next_key_pos == NULL || found_pos < next_key_pos)) {
+            if (found_pos == p || isspace((unsigned char)*(found_pos - 1))) {
+                next_key_pos = found_pos;
+                *found_keyname = keys[i];
+            }
+        }
+    }
+    return next_key_pos;
+}
+
+static bool legacy_parse(char *args, Student *patch) {
+    char *p = args;
+    while (p && *p) {
+        const char *key_name = NULL;
+        char *key_start = legacy_next_key(p, &key_name);
+        if (!key_start) break;
+
+        char *eq = strchr(key_start + strlen(key_name), '=');
+        char *check_ptr = key_start + strlen(key_name);
+        while (check_ptr < eq && isspace((unsigned char)*check_ptr)) check_ptr++;
+        if (!eq || check_ptr != eq) return false;
+
+        char *value_start = eq + 1;
+        while (*value_start && isspace((unsigned char)*value_start)) value_start++;
+        const char *next_key = NULL;
+        char *value_end = legacy_next_key(value_start, &next_key);
+
+        char value_buf[256];
+        size_t len;
+        if (value_end == NULL) {
+            len = strlen(value_start);
+            p = NULL;
+        } else {
+            len = value_end - value_start;
+            p = value_end;
+        }
+        if (len > sizeof(value_buf) - 1) len = sizeof(value_buf) - 1;
+        strncpy(value_buf, value_start, len);
+        value_buf[len] = '\0';
+        str_trim(value_buf);
+        size_t value_len = strlen(value_buf);
+        if (value_len > 2 && value_buf[0] == '"' && value_buf[value_len - 1] == '"') {
+            value_buf[value_len - 1] = '\0';
+            memmove(value_buf, value_buf + 1, value_len - 1);
+        }
+
+        if (str_ieq(key_name, "ID")) {
+            if (!parse_int(value_buf, &patch->id)) return false;
+        } else if (str_ieq(key_name, "Name")) {
+            strncpy(patch->name, value_buf, sizeof(patch->name));
+            patch->name[sizeof(patch->name) - 1] = '\0';
+        } else if (str_ieq(key_name, "Programme")) {
+            patch->programme = prog_intern(value_buf);
+        } else if (str_ieq(key_name, "Mark")) {
+            if (!parse_float(value_buf, &patch->mark)) return false;
+        }
+    }
+    return true;
+}
+
+static void init_patch(Student *patch) {
+    memset(patch, 0, sizeof *patch);
+    patch->id = -1;
+    patch->mark = -1.0f;
+}
+
+// Line i with a Programme value of prog_len bytes (at most 200, so the old
+// parser's 256-byte staging buffer never truncates it)
+static void make_line(char *dst, size_t cap, size_t i, size_t prog_len) {
+    char prog[256];
+    size_t n = (size_t)snprintf(prog, sizeof prog, "Programme %zu", i % 12);
+    for (; n < prog_len; n++) prog[n] = "abcdefghij"[n % 10];
+    prog[n] = '\0';
+    snprintf(dst, cap, "ID=%zu Name=\"Student %zu\" Programme=\"%s\" Mark=%.1f",
+             1000000 + i, i, prog, (double)(i % 1001) / 10.0);
+}
+
+typedef bool (*ParseFn)(char *args, Student *patch);
+
+// Interns the programme as INSERT does once a row is accepted, so both
+// parsers do the same work
+static bool kv_parse(char *args, Student *patch) {
+    char programme[KV_PROG_LEN] = "";
+    if (!kv_parse_student(args, patch, programme, stderr)) return false;
+    patch->programme = prog_intern(programme);
+    return true;
+}
+
+static double time_parse(ParseFn fn, char **lines, size_t n, char *scratch, size_t *bytes) {
+    Student patch;
+    size_t sink = 0;
+    *bytes = 0;
+    double t0 = now_sec();
+    for (size_t i = 0; i < n; i++) {
+        size_t len = strlen(lines[i]);
+        memcpy(scratch, lines[i], len + 1);
+        init_patch(&patch);
+        if (!fn(scratch, &patch)) {
+            fprintf(stderr, "Parse failed: %s\n", lines[i]);
+            exit(1);
+        }
+        sink += (size_t)patch.id;
+        *bytes += len;
+    }
+    double elapsed = now_sec() - t0;
+    if (sink == 0) puts("");
+    return elapsed;
+}
+
+int main(int argc, char **argv) {
+    size_t n = argc > 1 ? (size_t)strtoull(argv[1], NULL, 10) : 200000;
+    static const size_t prog_lens[] = { 16, 50, 100, 200 };
+    char **lines = malloc(n * sizeof *lines);
+    char scratch[512];
+    if (!lines) return 1;
+
+    printf("%10s %10s %14s %14s %10s\n", "prog_len", "line_len", "legacy_ns", "kv_ns", "kv_MB/s");
+    for (size_t k = 0; k < sizeof prog_lens / sizeof *prog_lens; k++) {
+        for (size_t i = 0; i < n; i++) {
+            char buf[512];
+            make_line(buf, sizeof buf, i, prog_lens[k]);
+            lines[i] = strdup(buf);
+            if (!lines[i]) return 1;
+        }
+
+        // Both parsers must fill the same fields
+        for (size_t i = 0; i < n; i += 997) {
+            Student a, b;
+            char copy[512];
+            init_patch(&a);
+            init_patch(&b);
+            strcpy(copy, lines[i]);
+            legacy_parse(copy, &a);
+            strcpy(copy, lines[i]);
+            kv_parse(copy, &b);
+            if (a.id != b.id || strcmp(a.name, b.name) != 0 || a.programme != b.programme || a.mark != b.mark) {
+                fprintf(stderr, "Mismatch on line %zu: %s\n", i, lines[i]);
+                return 1;
+            }
+        }
+
+        size_t bytes;
+        double legacy_s = time_parse(legacy_parse, lines, n, scratch, &bytes);
+        double kv_s = time_parse(kv_parse, lines, n, scratch, &bytes);
+        printf("%10zu %10zu %14.1f %14.1f %10.1f\n", prog_lens[k], bytes / n,
+               legacy_s * 1e9 / (double)n, kv_s * 1e9 / (double)n, (double)bytes / kv_s / 1e6);
+
+        for (size_t i = 0; i < n; i++) free(lines[i]);
+    }
+    free(lines);
+    return 0;
+}
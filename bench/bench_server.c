@@ -0,0 +1,163 @@
+// Server mode load generator: concurrent clients send commands over the Unix
+// socket and time each reply, then report throughput and latency percentiles.
+// Reads are QUERY ID=<id> for IDs drawn from [id_lo, id_hi]; write_pct percent
+// of requests are UPDATE ID=<id> Mark=<m> instead.
+//
+// Build and run from the repository root (start ./cms --serve first):
+//   gcc -O2 bench/bench_server.c -o bench_server -lpthread
+//   ./bench_server <socket> [clients] [requests_per_client] [write_pct] [id_lo] [id_hi]
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#define REPLY_END "\n.\n"   // A reply ends with a line holding a single '.'
+
+typedef struct {
+    const char *path;
+    size_t requests;
+    int write_pct;
+    int id_lo, id_hi;
+    unsigned seed;
+    double *latency;        // Seconds, one per request
+    size_t errors;          // Requests lost to a dropped connection
+} ClientRun;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int connect_to(const char *path) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    snprintf(addr.sun_path, sizeof addr.sun_path, "%s", path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof addr) != 0) {
+        perror(path);
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static bool send_all(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, buf, len, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        buf += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+// Read until the reply marker; only the tail is kept, so replies may be long
+static bool read_reply(int fd) {
+    char buf[4096];
+    char tail[sizeof REPLY_END] = "\n";   // Replies start on a fresh line
+    size_t tail_len = 1;
+    for (;;) {
+        ssize_t n = recv(fd, buf, sizeof buf, 0);
+        if (n <= 0) return false;
+        for (ssize_t i = 0; i < n; i++) {
+            if (tail_len == sizeof REPLY_END - 1) {
+                memmove(tail, tail + 1, tail_len - 1);
+                tail_len--;
+            }
+            tail[tail_len++] = buf[i];
+        }
+        if (tail_len == sizeof REPLY_END - 1 && memcmp(tail, REPLY_END, tail_len) == 0) return true;
+    }
+}
+
+static void *client_main(void *arg) {
+    ClientRun *run = arg;
+    int fd = connect_to(run->path);
+    if (fd < 0) {
+        run->errors = run->requests;
+        return NULL;
+    }
+
+    char cmd[128];
+    for (size_t i = 0; i < run->requests; i++) {
+        int id = run->id_lo + (int)(rand_r(&run->seed) % (unsigned)(run->id_hi - run->id_lo + 1));
+        int len;
+        if ((int)(rand_r(&run->seed) % 100) < run->write_pct) {
+            len = snprintf(cmd, sizeof cmd, "UPDATE ID=%d Mark=%.1f\n", id, (double)(rand_r(&run->seed) % 1001) / 10.0);
+        } else {
+            len = snprintf(cmd, sizeof cmd, "QUERY ID=%d\n", id);
+        }
+
+        double t0 = now_sec();
+        if (!send_all(fd, cmd, (size_t)len) || !read_reply(fd)) {
+            run->errors += run->requests - i;
+            break;
+        }
+        run->latency[i] = now_sec() - t0;
+    }
+    close(fd);
+    return NULL;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <socket> [clients] [requests_per_client] [write_pct] [id_lo] [id_hi]\n", argv[0]);
+        return 2;
+    }
+    size_t clients = argc > 2 ? (size_t)strtoull(argv[2], NULL, 10) : 8;
+    size_t requests = argc > 3 ? (size_t)strtoull(argv[3], NULL, 10) : 5000;
+    int write_pct = argc > 4 ? atoi(argv[4]) : 0;
+    int id_lo = argc > 5 ? atoi(argv[5]) : 1000000;
+    int id_hi = argc > 6 ? atoi(argv[6]) : 1399999;
+    if (clients == 0 || requests == 0 || id_hi < id_lo) {
+        fprintf(stderr, "Need at least one client and request, and id_lo <= id_hi\n");
+        return 2;
+    }
+
+    ClientRun *runs = calloc(clients, sizeof *runs);
+    pthread_t *tids = calloc(clients, sizeof *tids);
+    double *latency = calloc(clients * requests, sizeof *latency);
+    if (!runs || !tids || !latency) return 1;
+
+    double t0 = now_sec();
+    for (size_t c = 0; c < clients; c++) {
+        runs[c] = (ClientRun){
+            .path = argv[1], .requests = requests, .write_pct = write_pct,
+            .id_lo = id_lo, .id_hi = id_hi, .seed = 12345u + (unsigned)c,
+            .latency = latency + c * requests,
+        };
+        if (pthread_create(&tids[c], NULL, client_main, &runs[c]) != 0) {
+            fprintf(stderr, "Failed to start client %zu\n", c);
+            return 1;
+        }
+    }
+    size_t errors = 0;
+    for (size_t c = 0; c < clients; c++) {
+        pthread_join(tids[c], NULL);
+        errors += runs[c].errors;
+    }
+    double elapsed = now_sec() - t0;
+
+    size_t total = clients * requests;
+    qsort(latency, total, sizeof *latency, cmp_double);
+    printf("clients=%zu requests=%zu write_pct=%d errors=%zu\n", clients, total, write_pct, errors);
+    printf("throughput: %.0f requests/s over %.3f s\n", (double)total / elapsed, elapsed);
+    printf("latency_us: p50=%.1f p90=%.1f p99=%.1f p99.9=%.1f max=%.1f\n",
+           latency[total * 50 / 100] * 1e6, latency[total * 90 / 100] * 1e6,
+           latency[total * 99 / 100] * 1e6, latency[total * 999 / 1000] * 1e6, latency[total - 1] * 1e6);
+
+    free(runs);
+    free(tids);
+    free(latency);
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,154 @@
+// SORT BY benchmark: the radix engine behind store_sort against the previous
+// qsort-on-pairs path, by ID and by mark in both directions. Ordering time is
+// reported apart from applying the permutation to the columns, which both
+// paths share. Also checks the radix result is ordered and stable.
+//
+// Build and run from the repository root:
+//   gcc -O2 -Iinclude bench/bench_sort.c src/sort.c src/store.c src/markindex.c src/markscan.c src/metrics.c src/trigram.c src/progdict.c src/util.c -o bench_sort -lpthread
+//   ./bench_sort [max_rows]
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "sort.h"
+#include "store.h"
+
+#define BASE_ID 1000000
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Shuffled unique IDs (7919 is prime, so the stride visits every residue when
+// n is a power of ten) and marks with many duplicates to exercise stability
+static void fill_store(Store *s, size_t n) {
+    ProgCode prog = prog_intern("Computer Science");
+    if (!store_append_raw(s, n)) {
+        fprintf(stderr, "Out of memory for %zu rows\n", n);
+        exit(1);
+    }
+    for (size_t i = 0; i < n; i++) {
+        s->ids[i] = BASE_ID + (int)((i * 7919u) % n);
+        char name[NAME_LEN];
+        int len = snprintf(name, sizeof name, "Student %zu", i);
+        if (!store_set_name(s, i, name, (size_t)len)) {
+            fprintf(stderr, "Out of memory for names\n");
+            exit(1);
+        }
+        s->progs[i] = prog;
+        s->marks[i] = (float)((i * 37u) % 1001u) / 10.0f;
+    }
+    store_reindex(s);
+}
+
+// The qsort path store_sort used before the radix engine
+typedef struct {
+    float key;
+    unsigned slot;
+} PairF;
+
+typedef struct {
+    int key;
+    unsigned slot;
+} PairI;
+
+static int cmp_pair_f(const void *a, const void *b) {
+    const PairF *x = a, *y = b;
+    if (x->key != y->key) return (x->key > y->key) - (x->key < y->key);
+    return (x->slot > y->slot) - (x->slot < y->slot);
+}
+
+static int cmp_pair_i(const void *a, const void *b) {
+    const PairI *x = a, *y = b;
+    if (x->key != y->key) return (x->key > y->key) - (x->key < y->key);
+    return (x->slot > y->slot) - (x->slot < y->slot);
+}
+
+static void qsort_order(const Store *s, SortKey key, bool asc, size_t *order) {
+    size_t n = s->size;
+    if (key == SORT_BY_ID) {
+        PairI *p = malloc(n * sizeof *p);
+        for (size_t i = 0; i < n; i++) p[i] = (PairI){ s->ids[i], (unsigned)i };
+        qsort(p, n, sizeof *p, cmp_pair_i);
+        for (size_t i = 0; i < n; i++) order[i] = p[i].slot;
+        free(p);
+    } else {
+        PairF *p = malloc(n * sizeof *p);
+        for (size_t i = 0; i < n; i++) p[i] = (PairF){ s->marks[i], (unsigned)i };
+        qsort(p, n, sizeof *p, cmp_pair_f);
+        for (size_t i = 0; i < n; i++) order[i] = p[i].slot;
+        free(p);
+    }
+    if (!asc) {
+        for (size_t i = 0, j = n - 1; i < j; i++, j--) {
+            size_t t = order[i];
+            order[i] = order[j];
+            order[j] = t;
+        }
+    }
+}
+
+// Keys in the requested order, equal keys in their original slot order
+static bool check_sorted(const Store *s, SortKey key, bool asc, const size_t *orig_slot) {
+    for (size_t i = 1; i < s->size; i++) {
+        double a = key == SORT_BY_ID ? s->ids[i - 1] : s->marks[i - 1];
+        double b = key == SORT_BY_ID ? s->ids[i] : s->marks[i];
+        if (asc ? a > b : a < b) return false;
+        if (a == b && orig_slot[s->ids[i - 1] - BASE_ID] > orig_slot[s->ids[i] - BASE_ID]) return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    size_t max_rows = argc > 1 ? (size_t)strtoull(argv[1], NULL, 10) : 10000000;
+    static const struct {
+        SortKey key;
+        bool asc;
+        const char *label;
+    } cases[] = {
+        { SORT_BY_ID, true, "id_asc" },
+        { SORT_BY_ID, false, "id_desc" },
+        { SORT_BY_MARK, true, "mark_asc" },
+        { SORT_BY_MARK, false, "mark_desc" },
+    };
+
+    printf("%10s %10s %10s %10s %8s %10s\n", "rows", "case", "qsort_s", "radix_s", "speedup", "apply_s");
+    for (size_t n = 100000; n <= max_rows; n *= 10) {
+        size_t *order = malloc(n * sizeof *order);
+        size_t *orig_slot = malloc(n * sizeof *orig_slot);
+        if (!order || !orig_slot) {
+            fprintf(stderr, "Out of memory for %zu rows\n", n);
+            return 1;
+        }
+
+        for (size_t c = 0; c < sizeof cases / sizeof cases[0]; c++) {
+            Store s;
+            store_init(&s);
+            fill_store(&s, n);   // Fresh shuffled input for every case
+            double t0 = now_sec();
+            qsort_order(&s, cases[c].key, cases[c].asc, order);
+            double qsort_s = now_sec() - t0;
+
+            t0 = now_sec();
+            store_sort_order(&s, cases[c].key, cases[c].asc, order);
+            double radix_s = now_sec() - t0;
+
+            for (size_t i = 0; i < n; i++) orig_slot[s.ids[i] - BASE_ID] = i;
+            t0 = now_sec();
+            store_apply_order(&s, order);
+            double apply_s = now_sec() - t0;
+
+            if (!check_sorted(&s, cases[c].key, cases[c].asc, orig_slot)) {
+                fprintf(stderr, "%s at %zu rows is not ordered and stable\n", cases[c].label, n);
+                return 1;
+            }
+            printf("%10zu %10s %10.4f %10.4f %7.1fx %10.4f\n",
+                   n, cases[c].label, qsort_s, radix_s, qsort_s / radix_s, apply_s);
+            store_free(&s);
+        }
+        free(order);
+        free(orig_slot);
+    }
+    return 0;
+}
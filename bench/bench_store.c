@@ -0,0 +1,88 @@
+// Store scaling benchmark: load, insert and query cost as the roster grows.
+//
+// Build and run from the repository root:
+//   gcc -O2 -Iinclude bench/bench_store.c src/store.c src/io.c src/snapshot.c src/markindex.c src/markscan.c src/metrics.c src/trigram.c src/progdict.c src/util.c -o bench_store -lpthread
+//   ./bench_store [max_rows]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "io.h"
+#include "store.h"
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Deterministic, collision-free IDs spread over the valid 6-8 digit range
+static int bench_id(size_t i) {
+    return 1000000 + (int)((i * 7919u) % 90000000u);
+}
+
+static Student bench_student(size_t i) {
+    Student st = {0};
+    st.id = bench_id(i);
+    snprintf(st.name, sizeof st.name, "Student %zu", i);
+    char programme[32];
+    snprintf(programme, sizeof programme, "Programme %zu", i % 12);
+    st.programme = prog_intern(programme);
+    st.mark = (float)(i % 1001) / 10.0f;
+    return st;
+}
+
+static void write_roster(const char *path, size_t n) {
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        perror(path);
+        exit(1);
+    }
+    for (size_t i = 0; i < n; i++) {
+        Student st = bench_student(i);
+        fprintf(fp, "%d\t%s\t%s\t%.1f\n", st.id, st.name, prog_name(st.programme), st.mark);
+    }
+    fclose(fp);
+}
+
+int main(int argc, char **argv) {
+    size_t max_rows = argc > 1 ? (size_t)strtoull(argv[1], NULL, 10) : 1000000;
+    const char *path = "bench_roster.tmp";
+
+    printf("%10s %12s %12s %12s\n", "rows", "load_s", "insert_s", "query_ns");
+    for (size_t n = 10000; n <= max_rows; n *= 10) {
+        write_roster(path, n);
+
+        Store s;
+        store_init(&s);
+        int skipped = 0;
+        double t0 = now_sec();
+        cms_load(path, &s, &skipped);
+        double load_s = now_sec() - t0;
+        store_free(&s);
+
+        store_init(&s);
+        t0 = now_sec();
+        for (size_t i = 0; i < n; i++) {
+            store_insert(&s, bench_student(i));
+        }
+        double insert_s = now_sec() - t0;
+
+        size_t hits = 0;
+        t0 = now_sec();
+        for (size_t i = 0; i < n; i++) {
+            hits += store_find_index_by_id(&s, bench_id((i * 31u) % n)) >= 0;
+        }
+        double query_ns = (now_sec() - t0) * 1e9 / (double)n;
+        store_free(&s);
+
+        if (hits != n || skipped != 0) {
+            fprintf(stderr, "Unexpected result at %zu rows: hits=%zu skipped=%d\n", n, hits, skipped);
+            return 1;
+        }
+        printf("%10zu %12.4f %12.4f %12.1f\n", n, load_s, insert_s, query_ns);
+    }
+
+    remove(path);
+    return 0;
+}
@@ -0,0 +1,529 @@
+// Benchmark suite: generates a deterministic roster in every file format CMS
+// reads (TSV database, CSV import, binary snapshot), then times loading,
+// saving, the core store operations, statistics and each FIND plan on it.
+// Results are appended to bench_output.txt as tab-separated lines, one per
+// (benchmark, rows), tagged with a label so runs from different commits can
+// be kept in one file and compared:
+//
+//   label  benchmark  rows  ops  repeats  best_s  median_s  ns_per_op  check
+//
+// check is a result digest (rows loaded, matches, bytes printed) that must not
+// change between commits; a different value means behaviour changed, not speed.
+//
+// Build and run from the repository root:
+//   gcc -std=gnu11 -O2 -Iinclude bench/bench_suite.c src/find.c src/io.c src/journal.c src/markindex.c src/markscan.c src/metrics.c src/pool.c src/progdict.c src/render.c src/snapshot.c src/sort.c src/stats.c src/store.c src/trigram.c src/util.c src/version.c src/view.c -o bench_suite -lpthread
+//   ./bench_suite [-l label] [-o file] [-r repeats] [-g] [rows ...]
+//
+// rows defaults to 10000 100000 1000000; anything from 10000 to 50000000 is
+// accepted. -g only writes the generated files (bench_suite_<rows>.tsv, .csv
+// and .cmsb) and keeps them. -l defaults to "local"; pass the commit, e.g.
+// -l "$(git rev-parse --short HEAD)".
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "find.h"
+#include "io.h"
+#include "snapshot.h"
+#include "sort.h"
+#include "stats.h"
+#include "store.h"
+#include "version.h"
+
+#define MIN_ROWS 10000u
+#define MAX_ROWS 50000000u
+#define MAX_SIZES 16
+#define MAX_LOOKUPS 1000000u // Per repeat, so large rosters stay quick
+#define MAX_DELETES 10000u   // Deletes also update the name trigram lists
+#define SEED 0x434d5342u     // "CMSB"
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// ---- Generator -------------------------------------------------------------
+
+static const char *FIRST[] = {
+    "Aiden", "Amelia", "Ananya", "Ben", "Carlos", "Chen", "Chloe", "Daniel",
+    "Elena", "Emma", "Farah", "Grace", "Hiroshi", "Isabel", "Jack", "Jia Hui",
+    "Kofi", "Liam", "Lucas", "Mei Ling", "Mohammed", "Nadia", "Noah", "Olivia",
+    "Priya", "Rahul", "Sofia", "Siew Mei", "Thomas", "Wei Jie", "Yusuf", "Zara",
+};
+
+static const char *LAST[] = {
+    "Abdullah", "Brown", "Chan", "Da Silva", "Fernandez", "Goh", "Gupta", "Ibrahim",
+    "Johnson", "Kaur", "Kim", "Lee", "Lim", "Mensah", "Muller", "Nguyen",
+    "O'Connor", "Okafor", "Patel", "Rossi", "Sato", "Schmidt", "Singh", "Smith",
+    "Tan", "Taylor", "van der Berg", "Wang", "Williams", "Wong", "Yamamoto", "Zhang",
+};
+
+// Commas in a few programmes make the CSV file exercise quoted fields
+static const char *PROGRAMMES[] = {
+    "Computer Science", "Software Engineering", "Data Science", "Information Systems",
+    "Electrical Engineering", "Mechanical Engineering", "Civil Engineering",
+    "Mathematics", "Physics", "Chemistry", "Biology", "Medicine", "Nursing",
+    "Law", "Accounting", "Finance", "Economics", "Business Administration",
+    "Philosophy, Politics and Economics", "History", "English Literature",
+    "Psychology", "Architecture", "Art, Design and Media",
+};
+
+#define N_FIRST (sizeof FIRST / sizeof *FIRST)
+#define N_LAST (sizeof LAST / sizeof *LAST)
+#define N_PROGRAMMES (sizeof PROGRAMMES / sizeof *PROGRAMMES)
+
+// splitmix64 keyed by row number, so row i is the same whatever else is generated
+static uint64_t mix(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+// Unique 8-digit IDs in shuffled order for every i below 90,000,000
+static int gen_id(size_t i) {
+    return 10000000 + (int)(((uint64_t)i * 7919u) % 90000000u);
+}
+
+// Row i of the roster. Marks cluster around 65 like real grades: the sum of
+// four uniform draws, clamped to 0-100 and rounded to one decimal.
+static Student gen_student(size_t i) {
+    uint64_t r = mix(SEED ^ (uint64_t)i);
+    Student st = {0};
+    st.id = gen_id(i);
+    snprintf(st.name, sizeof st.name, "%s %s", FIRST[r % N_FIRST], LAST[(r >> 8) % N_LAST]);
+    st.programme = prog_intern(PROGRAMMES[(r >> 16) % N_PROGRAMMES]);
+    int tenths = 0;
+    for (int k = 0; k < 4; k++) {
+        tenths += (int)((r >> (24 + 10 * k)) % 1001u);
+    }
+    tenths = (tenths - 2000) / 5 + 650;
+    if (tenths < 0) tenths = 0;
+    if (tenths > 1000) tenths = 1000;
+    st.mark = (float)tenths / 10.0f;
+    return st;
+}
+
+static void csv_field(FILE *fp, const char *text) {
+    if (!strpbrk(text, ",\"")) {
+        fputs(text, fp);
+        return;
+    }
+    fputc('"', fp);
+    for (const char *p = text; *p; p++) {
+        if (*p == '"') fputc('"', fp);
+        fputc(*p, fp);
+    }
+    fputc('"', fp);
+}
+
+static void write_text(const char *path, size_t n, bool csv) {
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        perror(path);
+        exit(1);
+    }
+    if (csv) fputs("ID,Name,Programme,Mark\n", fp);
+    for (size_t i = 0; i < n; i++) {
+        Student st = gen_student(i);
+        if (csv) {
+            fprintf(fp, "%d,", st.id);
+            csv_field(fp, st.name);
+            fputc(',', fp);
+            csv_field(fp, prog_name(st.programme));
+            fprintf(fp, ",%.1f\n", st.mark);
+        } else {
+            fprintf(fp, "%d\t%s\t%s\t%.1f\n", st.id, st.name, prog_name(st.programme), st.mark);
+        }
+    }
+    if (fclose(fp) != 0) {
+        perror(path);
+        exit(1);
+    }
+}
+
+typedef struct {
+    char tsv[64];
+    char csv[64];
+    char snap[64];
+    char out_tsv[64];
+    char out_snap[64];
+} Paths;
+
+static void make_paths(Paths *p, size_t n) {
+    snprintf(p->tsv, sizeof p->tsv, "bench_suite_%zu.tsv", n);
+    snprintf(p->csv, sizeof p->csv, "bench_suite_%zu.csv", n);
+    snprintf(p->snap, sizeof p->snap, "bench_suite_%zu%s", n, SNAPSHOT_EXT);
+    snprintf(p->out_tsv, sizeof p->out_tsv, "bench_suite_%zu.out.tsv", n);
+    snprintf(p->out_snap, sizeof p->out_snap, "bench_suite_%zu.out%s", n, SNAPSHOT_EXT);
+}
+
+static void generate(const Paths *p, size_t n) {
+    write_text(p->tsv, n, false);
+    write_text(p->csv, n, true);
+    size_t rows = 0;
+    int skipped = 0;
+    if (!cms_convert(p->tsv, p->snap, &rows, &skipped) || rows != n) {
+        fprintf(stderr, "Failed to write %s\n", p->snap);
+        exit(1);
+    }
+}
+
+// ---- Timing ----------------------------------------------------------------
+
+typedef struct {
+    FILE *out;
+    const char *label;
+    int repeats;
+} Suite;
+
+// One measured benchmark: setup (untimed) then run (timed), repeated
+typedef struct {
+    const char *name;
+    size_t rows;
+    size_t ops;            // Units of work per repeat, for ns_per_op
+    void (*setup)(void *ctx);
+    uint64_t (*run)(void *ctx);   // Returns the check digest
+    void (*teardown)(void *ctx);
+    void *ctx;
+} Bench;
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void bench_run(const Suite *suite, const Bench *b) {
+    double t[64];
+    int reps = suite->repeats;
+    uint64_t check = 0;
+    for (int r = 0; r < reps; r++) {
+        if (b->setup) b->setup(b->ctx);
+        double t0 = now_sec();
+        uint64_t c = b->run(b->ctx);
+        t[r] = now_sec() - t0;
+        if (b->teardown) b->teardown(b->ctx);
+        if (r > 0 && c != check) {
+            fprintf(stderr, "%s at %zu rows: check %llu differs from %llu between repeats\n",
+                    b->name, b->rows, (unsigned long long)c, (unsigned long long)check);
+            exit(1);
+        }
+        check = c;
+    }
+    qsort(t, (size_t)reps, sizeof *t, cmp_double);
+    double best = t[0], median = t[reps / 2];
+    double ns = b->ops ? best * 1e9 / (double)b->ops : 0.0;
+
+    fprintf(suite->out, "%s\t%s\t%zu\t%zu\t%d\t%.6f\t%.6f\t%.1f\t%llu\n", suite->label, b->name,
+            b->rows, b->ops, reps, best, median, ns, (unsigned long long)check);
+    fflush(suite->out);
+    printf("%-16s %10zu %12.6f %12.6f %12.1f\n", b->name, b->rows, best, median, ns);
+}
+
+// ---- Benchmarks ------------------------------------------------------------
+
+typedef struct {
+    const Paths *paths;
+    size_t n;
+    Store s;              // Loaded roster, shared by the read-only benchmarks
+    Store work;           // Fresh copy for benchmarks that change the store
+    VersionDomain versions;
+    FILE *sink;
+    uint64_t sink_bytes;
+    FindQuery *query;
+} Ctx;
+
+static void load_or_die(const char *path, Store *s) {
+    int skipped = 0;
+    store_init(s);
+    if (!cms_load(path, s, &skipped) || skipped != 0) {
+        fprintf(stderr, "Failed to load %s\n", path);
+        exit(1);
+    }
+}
+
+static void free_work(void *arg) {
+    Ctx *c = arg;
+    store_free(&c->work);
+}
+
+static void load_work(void *arg) {
+    Ctx *c = arg;
+    load_or_die(c->paths->snap, &c->work);
+}
+
+static uint64_t run_load_tsv(void *arg) {
+    Ctx *c = arg;
+    load_or_die(c->paths->tsv, &c->work);
+    return c->work.size;
+}
+
+static uint64_t run_load_snapshot(void *arg) {
+    Ctx *c = arg;
+    load_or_die(c->paths->snap, &c->work);
+    return c->work.size;
+}
+
+static uint64_t run_import_csv(void *arg) {
+    Ctx *c = arg;
+    ImportReport rep;
+    store_init(&c->work);
+    if (!cms_import(c->paths->csv, &c->work, &rep)) {
+        fprintf(stderr, "Failed to import %s\n", c->paths->csv);
+        exit(1);
+    }
+    return rep.added;
+}
+
+static uint64_t save_to(const Ctx *c, const char *path) {
+    if (!cms_save(path, &c->s)) {
+        fprintf(stderr, "Failed to save %s\n", path);
+        exit(1);
+    }
+    return c->s.size;
+}
+
+static uint64_t run_save_tsv(void *arg) {
+    return save_to(arg, ((Ctx *)arg)->paths->out_tsv);
+}
+
+static uint64_t run_save_snapshot(void *arg) {
+    return save_to(arg, ((Ctx *)arg)->paths->out_snap);
+}
+
+static void init_work(void *arg) {
+    Ctx *c = arg;
+    store_init(&c->work);
+}
+
+static uint64_t run_insert(void *arg) {
+    Ctx *c = arg;
+    uint64_t added = 0;
+    for (size_t i = 0; i < c->n; i++) {
+        added += store_insert(&c->work, gen_student(i));
+    }
+    return added;
+}
+
+static size_t capped(size_t n, size_t cap) {
+    return n < cap ? n : cap;
+}
+
+// Every other lookup misses with a 9-digit ID no roster row can hold
+static uint64_t run_lookup(void *arg) {
+    Ctx *c = arg;
+    size_t ops = capped(c->n, MAX_LOOKUPS);
+    uint64_t hits = 0;
+    for (size_t k = 0; k < ops; k++) {
+        int id = gen_id((size_t)(mix(k) % c->n)) + (k & 1 ? 90000000 : 0);
+        hits += store_find_index_by_id(&c->s, id) >= 0;
+    }
+    return hits;
+}
+
+static uint64_t run_delete(void *arg) {
+    Ctx *c = arg;
+    size_t ops = capped(c->n / 2, MAX_DELETES);
+    uint64_t gone = 0;
+    for (size_t k = 0; k < ops; k++) {
+        gone += store_delete(&c->work, gen_id((k * 2654435761u) % c->n));
+    }
+    return gone * 1000003u + c->work.size;
+}
+
+// Sum of IDs weighted by final position, so a different order changes it
+static uint64_t order_digest(const Store *s) {
+    uint64_t h = 0;
+    for (size_t i = 0; i < s->size; i += 97) {
+        h = h * 1000003u + (uint64_t)s->ids[i];
+    }
+    return h;
+}
+
+static uint64_t run_sort_id(void *arg) {
+    Ctx *c = arg;
+    store_sort(&c->work, SORT_BY_ID, true);
+    return order_digest(&c->work);
+}
+
+static uint64_t run_sort_mark(void *arg) {
+    Ctx *c = arg;
+    store_sort(&c->work, SORT_BY_MARK, false);
+    return order_digest(&c->work);
+}
+
+static uint64_t run_stats(void *arg) {
+    Ctx *c = arg;
+    Stats st = compute_stats(c->s.marks, c->s.size);
+    return (uint64_t)st.band_A * 1000003u + (uint64_t)(st.average * 1000.0f) + (uint64_t)st.max_idx;
+}
+
+static void reset_sink(void *arg) {
+    Ctx *c = arg;
+    c->sink_bytes = 0;
+}
+
+static uint64_t run_find(void *arg) {
+    Ctx *c = arg;
+    if (!find_run(c->sink, stderr, c->query, &c->s) || fflush(c->sink) != 0) {
+        fprintf(stderr, "FIND failed\n");
+        exit(1);
+    }
+    return c->sink_bytes;
+}
+
+static uint64_t run_find_version(void *arg) {
+    Ctx *c = arg;
+    VersionPin pin;
+    if (!version_pin(&c->versions, &c->s, &pin)) {
+        fprintf(stderr, "Failed to pin a version\n");
+        exit(1);
+    }
+    bool ok = find_run_version(c->sink, stderr, c->query, pin.v);
+    version_unpin(&pin);
+    if (!ok || fflush(c->sink) != 0) {
+        fprintf(stderr, "FIND failed\n");
+        exit(1);
+    }
+    return c->sink_bytes;
+}
+
+// FIND output is counted and dropped, so the suite times the query and the
+// formatting but not a terminal or disk
+static ssize_t sink_write(void *cookie, const char *buf, size_t size) {
+    (void)buf;
+    *(uint64_t *)cookie += size;
+    return (ssize_t)size;
+}
+
+// One query per candidate plan in find_run, plus a version scan
+static const struct {
+    const char *name;
+    const char *expr;
+    bool version;
+} FINDS[] = {
+    { "find_id",        "ID = 10007919",                          false },  // ID hash
+    { "find_mark_range", "Mark >= 97.5",                          false },  // Mark index
+    { "find_name",      "Name CONTAINS \"Okafor\"",               false },  // Trigram index
+    { "find_mark_scan", "Mark < 60",                              false },  // Mark column scan
+    { "find_full_scan", "Programme = Law OR NOT Mark > 40",       false },  // Every row
+    { "find_version",   "Programme CONTAINS \"Engineering\"",     true  },  // Pinned version
+};
+
+static void bench_size(const Suite *suite, size_t n) {
+    Paths paths;
+    make_paths(&paths, n);
+    generate(&paths, n);
+
+    Ctx c = { .paths = &paths, .n = n };
+    load_or_die(paths.snap, &c.s);
+    version_domain_init(&c.versions);
+    c.sink = fopencookie(&c.sink_bytes, "w", (cookie_io_functions_t){ .write = sink_write });
+    if (!c.sink) {
+        perror("fopencookie");
+        exit(1);
+    }
+
+    const Bench benches[] = {
+        { "load_tsv",      n, n, NULL,       run_load_tsv,      free_work, &c },
+        { "load_snapshot", n, n, NULL,       run_load_snapshot, free_work, &c },
+        { "import_csv",    n, n, NULL,       run_import_csv,    free_work, &c },
+        { "save_tsv",      n, n, NULL,       run_save_tsv,      NULL,      &c },
+        { "save_snapshot", n, n, NULL,       run_save_snapshot, NULL,      &c },
+        { "insert",        n, n, init_work,  run_insert,        free_work, &c },
+        { "lookup",        n, capped(n, MAX_LOOKUPS), NULL, run_lookup,      NULL,      &c },
+        { "delete",        n, capped(n / 2, MAX_DELETES), load_work, run_delete, free_work, &c },
+        { "sort_id",       n, n, load_work,  run_sort_id,       free_work, &c },
+        { "sort_mark",     n, n, load_work,  run_sort_mark,     free_work, &c },
+        { "stats",         n, n, NULL,       run_stats,         NULL,      &c },
+    };
+    for (size_t i = 0; i < sizeof benches / sizeof *benches; i++) {
+        bench_run(suite, &benches[i]);
+    }
+
+    for (size_t i = 0; i < sizeof FINDS / sizeof *FINDS; i++) {
+        c.query = find_compile(FINDS[i].expr, stderr);
+        if (!c.query) exit(1);
+        Bench b = { FINDS[i].name, n, n, reset_sink,
+                    FINDS[i].version ? run_find_version : run_find, NULL, &c };
+        bench_run(suite, &b);
+        find_free(c.query);
+    }
+
+    fclose(c.sink);
+    version_domain_free(&c.versions);
+    store_free(&c.s);
+    remove(paths.tsv);
+    remove(paths.csv);
+    remove(paths.snap);
+    remove(paths.out_tsv);
+    remove(paths.out_snap);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-l label] [-o file] [-r repeats] [-g] [rows ...]\n", prog);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    Suite suite = { .label = "local", .repeats = 3 };
+    const char *out_path = "bench_output.txt";
+    bool generate_only = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "l:o:r:g")) != -1) {
+        switch (opt) {
+        case 'l': suite.label = optarg; break;
+        case 'o': out_path = optarg; break;
+        case 'r': suite.repeats = atoi(optarg); break;
+        case 'g': generate_only = true; break;
+        default: usage(argv[0]);
+        }
+    }
+    if (suite.repeats < 1 || suite.repeats > 64 || strpbrk(suite.label, "\t\n")) usage(argv[0]);
+
+    size_t sizes[MAX_SIZES] = { 10000, 100000, 1000000 };
+    size_t n_sizes = 3;
+    if (optind < argc) {
+        n_sizes = 0;
+        for (int i = optind; i < argc && n_sizes < MAX_SIZES; i++) {
+            size_t n = (size_t)strtoull(argv[i], NULL, 10);
+            if (n < MIN_ROWS || n > MAX_ROWS) {
+                fprintf(stderr, "Rows must be from %u to %u: %s\n", MIN_ROWS, MAX_ROWS, argv[i]);
+                return 2;
+            }
+            sizes[n_sizes++] = n;
+        }
+    }
+
+    if (generate_only) {
+        for (size_t i = 0; i < n_sizes; i++) {
+            Paths paths;
+            make_paths(&paths, sizes[i]);
+            generate(&paths, sizes[i]);
+            printf("Wrote %s, %s and %s\n", paths.tsv, paths.csv, paths.snap);
+        }
+        return 0;
+    }
+
+    suite.out = fopen(out_path, "a");
+    if (!suite.out) {
+        perror(out_path);
+        return 1;
+    }
+    fseek(suite.out, 0, SEEK_END);
+    if (ftell(suite.out) == 0) {
+        fputs("# label\tbenchmark\trows\tops\trepeats\tbest_s\tmedian_s\tns_per_op\tcheck\n", suite.out);
+    }
+
+    printf("%-16s %10s %12s %12s %12s\n", "benchmark", "rows", "best_s", "median_s", "ns_per_op");
+    for (size_t i = 0; i < n_sizes; i++) {
+        bench_size(&suite, sizes[i]);
+    }
+    fclose(suite.out);
+    printf("Results appended to %s\n", out_path);
+    return 0;
+}
@@ -1,12 +1,42 @@
 #ifndef CMD_H
 #define CMD_H
 #include "store.h"
+#include "version.h"
+#include <pthread.h>
 #include <stdbool.h>
+#include <stdio.h>
 
+// A store used by several threads at once. Commands that change it hold lock
+// exclusively and short reads hold it shared. Full listings and FIND scans
+// hold it only while pinning a version, then read the version, so they
+// neither wait for writers nor hold them up.
+typedef struct {
+    pthread_rwlock_t lock;
+    VersionDomain versions;
+} SharedStore;
+
+// Where one caller's commands write: the console, or a server client's buffer
+typedef struct {
+    FILE *out;      // Command results and confirmations
+    FILE *err;      // Error messages
+    bool batch;     // Skip interactive confirmations (DELETE)
+    SharedStore *shared;   // NULL if the caller has the store to itself
+} CmdContext;
 
 // Process single input line, returns false if user requested to exit.
 bool cmd_process_line(const char* line, Store *s, const char *db_path);
 
+// Same, with output going to ctx. With ctx->shared set, each command takes
+// the locks it needs, so concurrent callers may share s.
+bool cmd_execute(const CmdContext *ctx, const char *line, Store *s, const char *db_path);
+
+// Wait for a background SAVE to finish. True if s still has changes that are
+// not on disk.
+bool cmd_wait_saved(Store *s);
+
+// Batch mode skips interactive confirmations (DELETE) for scripted runs.
+void cmd_set_batch(bool batch);
+
 
 // Print the declaration block with team and member names and date.
 void print_declaration(const char *team_name, const char *member_names, const char *date_str);
@@ -0,0 +1,42 @@
+#ifndef FIND_H
+#define FIND_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "store.h"
+#include "version.h"
+
+// Row test for FIND scans. Runs on pool threads, so it must only read.
+typedef bool (*FindPred)(const Store *s, size_t slot, const void *arg);
+
+// Write the FIND result table for the rows that pass pred (all rows when pred
+// is NULL). Rows are slots[0, n) in the given order, or slots 0..n-1 when
+// slots is NULL. Large inputs are split across the worker pool; each part
+// formats into its own buffer and parts are written back in order, so the
+// output matches a sequential scan byte for byte. Errors are written to err.
+bool find_print(FILE *out, FILE *err, const Store *s, const int *slots, size_t n, FindPred pred, const void *arg);
+
+// A compiled FIND expression: comparisons `<Column> <Op> <Value>` over Name,
+// Programme, Mark and ID, joined with AND, OR, NOT and parentheses
+typedef struct FindQuery FindQuery;
+
+// Parse and lower expr into a tree of typed predicate nodes. Errors are
+// written to err; returns NULL on failure.
+FindQuery *find_compile(const char *expr, FILE *err);
+void find_free(FindQuery *q);
+
+// Print the rows of s matching q. One AND-ed comparison picks the candidate
+// rows (ID hash, mark index, trigram index or mark column scan) and the whole
+// tree is checked on each candidate; queries with no usable comparison scan
+// every row.
+bool find_run(FILE *out, FILE *err, const FindQuery *q, Store *s);
+
+// True if find_run would only visit a few index entries (an ID lookup, a
+// selective mark range or a name with few trigram candidates) rather than
+// scanning a whole column
+bool find_is_point(const FindQuery *q, Store *s);
+
+// Print the rows of a pinned version matching q, testing every row
+bool find_run_version(FILE *out, FILE *err, const FindQuery *q, const StoreVersion *v);
+
+#endif // FIND_H
@@ -3,7 +3,37 @@
 #include "store.h"
 #include <stdbool.h>
 
+typedef enum {
+    IMPORT_MALFORMED,       // Wrong number of fields or an unterminated quote
+    IMPORT_BAD_ID,          // Not a 6-8 digit number
+    IMPORT_BAD_NAME,        // Empty, 64 bytes or longer, or holding a tab
+    IMPORT_BAD_PROGRAMME,   // Empty, 64 bytes or longer, holding a tab, or not interned
+    IMPORT_BAD_MARK,        // Not a number from 0 to 100
+    IMPORT_DUP_STORE,       // ID already in the store
+    IMPORT_DUP_FILE,        // ID seen earlier in the same file
+    IMPORT_STORE_FAILED,    // Valid row the store could not take (out of memory)
+    IMPORT_REASONS
+} ImportReason;
+
+typedef struct {
+    size_t added;
+    size_t rejected[IMPORT_REASONS];
+    size_t first_line[IMPORT_REASONS];  // 1-based line of the first rejection per reason
+} ImportReport;
+
 bool cms_load(const char *path, Store *s, int *skipped_lines);
+
+// Append the rows of a TSV file (CSV if the name ends in .csv) to a live store.
+// An optional "ID,..." header line is skipped. False if the file cannot be read.
+bool cms_import(const char *path, Store *s, ImportReport *rep);
+const char *import_reason_name(ImportReason why);
+
+// Write s to path, replacing it atomically through <path>SAVE_TMP_SUFFIX.
+// Only the row columns of s are read, so a store_copy_rows copy will do.
+#define SAVE_TMP_SUFFIX ".tmp"
 bool cms_save(const char *path, const Store *s);
 
+// Rewrite src into dst; dst is a binary snapshot if it ends in SNAPSHOT_EXT, TSV otherwise
+bool cms_convert(const char *src, const char *dst, size_t *rows, int *skipped_lines);
+
 #endif // IO_H
\ No newline at end of file
@@ -0,0 +1,39 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+#include <stdbool.h>
+#include <stddef.h>
+#include "store.h"
+
+// Append-only write-ahead journal kept next to the database file (<db>.journal).
+// Mutations are buffered in memory and appended as one batch on commit, followed
+// by a commit marker and a single fsync. Replay only applies complete batches.
+#define JOURNAL_SUFFIX ".journal"
+
+typedef struct {
+    char path[512];
+    char *buf;          // Pending records not yet committed
+    size_t len;
+    size_t cap;
+    size_t pending;     // Number of records in buf
+    long committed;     // File length through the last commit marker, -1 until known
+} Journal;
+
+void journal_init(Journal *j, const char *db_path);
+void journal_free(Journal *j);
+
+// Queue a record for the next commit
+bool journal_log_insert(Journal *j, const Student *st);
+bool journal_log_update(Journal *j, int id, const Student *patch);  // patch uses sentinel values
+bool journal_log_delete(Journal *j, int id);
+
+bool journal_commit(Journal *j);     // Append pending records, then fsync once; nothing stays on failure
+void journal_discard(Journal *j);    // Drop pending records
+bool journal_truncate(Journal *j);   // Empty the journal after the base file was rewritten
+
+// Apply committed records on top of a freshly loaded base. Records that no longer
+// apply (e.g. an insert already folded into the base) are counted in *failed.
+// A torn batch after the last commit marker is cut off the file, so the next
+// commit cannot turn it into part of its own batch.
+bool journal_replay(Journal *j, Store *s, size_t *applied, size_t *failed);
+
+#endif // JOURNAL_H
@@ -0,0 +1,19 @@
+#ifndef KVPARSE_H
+#define KVPARSE_H
+#include <stdbool.h>
+#include <stdio.h>
+#include "student.h"
+
+// Parse the key=value fields of INSERT and UPDATE into patch in one pass.
+// Keys are ID, Name, Programme and Mark, in any case and order; a repeated
+// key keeps its last value. A value is either a double-quoted string, in
+// which a backslash escapes the next character, or bare text that runs up to
+// the next `<key>=`, so bare values may hold spaces and words like "Mark".
+// args is rewritten in place. The Programme goes to programme (KV_PROG_LEN
+// bytes) as text rather than into patch, so the caller interns it only once
+// the row is accepted. Leaves fields that are not given untouched; writes the
+// problem to err and returns false on malformed input.
+#define KV_PROG_LEN 64
+bool kv_parse_student(char *args, Student *patch, char *programme, FILE *err);
+
+#endif // KVPARSE_H
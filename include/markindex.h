@@ -0,0 +1,48 @@
+#ifndef MARKINDEX_H
+#define MARKINDEX_H
+#include <stdbool.h>
+#include <stddef.h>
+
+// Ordered secondary index on (mark, id): a treap whose nodes live in one pool,
+// addressed by int so the pool can grow with realloc.
+typedef struct {
+    float mark;
+    int id;
+    int left, right;     // -1 if none
+    unsigned prio;
+} MarkNode;
+
+typedef struct {
+    MarkNode *nodes;
+    size_t used;         // Nodes handed out from the pool so far
+    size_t cap;
+    int free_list;       // Recycled nodes chained through .left
+    int root;
+    unsigned seed;
+} MarkIndex;
+
+// Inclusive/exclusive bounds; use -INFINITY / INFINITY for open ends
+typedef struct {
+    float lo, hi;
+    bool lo_incl, hi_incl;
+} MarkRange;
+
+typedef void (*MarkVisitFn)(int id, void *ctx);
+
+void markindex_init(MarkIndex *mi);
+void markindex_free(MarkIndex *mi);
+
+bool markindex_insert(MarkIndex *mi, float mark, int id);
+void markindex_remove(MarkIndex *mi, float mark, int id);
+
+// Replace the contents with n (mark, id) pairs in O(n log n)
+bool markindex_build(MarkIndex *mi, const float *marks, const int *ids, size_t n);
+
+// Visit ids whose mark lies in range, in ascending (mark, id) order. Returns the count.
+size_t markindex_range(const MarkIndex *mi, MarkRange r, MarkVisitFn fn, void *ctx);
+
+// Id with the lowest/highest mark, -1 if empty
+int markindex_min_id(const MarkIndex *mi);
+int markindex_max_id(const MarkIndex *mi);
+
+#endif // MARKINDEX_H
@@ -0,0 +1,45 @@
+#ifndef MARKSCAN_H
+#define MARKSCAN_H
+#include <stdbool.h>
+#include <stddef.h>
+#include "markindex.h"
+#include "store.h"
+
+// Vectorised scans over a mark column. Every kernel returns bit-identical
+// results: the sum is accumulated in 16 fixed double lanes (element i goes to
+// lane i % 16) and reduced in a fixed order, and min/max report the first slot
+// holding the extreme value.
+typedef enum {
+    MARKSCAN_SCALAR,
+    MARKSCAN_SSE2,
+    MARKSCAN_AVX2,
+    MARKSCAN_AVX512,
+    MARKSCAN_KERNELS
+} MarkScanKernel;
+
+typedef struct {
+    double sum;
+    float min, max;
+    int min_idx, max_idx;        // -1 if the column is empty
+    size_t band[GRADE_BANDS];    // 0 = A ... 4 = F, as mark_band
+} MarkScanStats;
+
+// One pass for sum, extremes and grade-band counts
+void markscan_stats(const float *marks, size_t n, MarkScanStats *out);
+
+// Write the slots whose mark lies in r to out (room for n), in ascending
+// slot order. Returns the count.
+size_t markscan_filter(const float *marks, size_t n, MarkRange r, int *out);
+
+// The inclusive bounds [lo, hi] that select the same marks as r
+void markscan_bounds(MarkRange r, float *lo, float *hi);
+
+// Kernel selection: the best one the CPU supports is chosen on first use.
+// markscan_select is for benchmarks and cross-checks; false if unsupported.
+MarkScanKernel markscan_best(void);
+bool markscan_supported(MarkScanKernel k);
+bool markscan_select(MarkScanKernel k);
+MarkScanKernel markscan_active(void);
+const char *markscan_kernel_name(MarkScanKernel k);
+
+#endif // MARKSCAN_H
@@ -0,0 +1,46 @@
+#ifndef METRICS_H
+#define METRICS_H
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Process-wide command latencies and work counters. Recording is a relaxed
+// atomic add (plus a clock read per command), so it is always on and safe
+// from server workers, pool threads and the background saver.
+
+typedef enum {
+    METRIC_ROWS_SCANNED,     // Rows a FIND predicate tested
+    METRIC_ROWS_MATCHED,     // Rows FIND printed
+    METRIC_ROWS_SORTED,      // Rows put in order by the sort engine
+    METRIC_GROW_REALLOCS,    // Column and name arena reallocations in the store
+    METRIC_GROW_BYTES,       // Live bytes those reallocations may have copied
+    METRIC_BYTES_READ,       // Database and import file bytes loaded
+    METRIC_BYTES_WRITTEN,    // Database file bytes saved
+    METRIC_COUNTERS
+} MetricCounter;
+
+extern atomic_uint_fast64_t metrics_counters[METRIC_COUNTERS];
+
+const char *metrics_counter_name(MetricCounter c);
+
+static inline void metrics_add(MetricCounter c, uint64_t n) {
+    atomic_fetch_add_explicit(&metrics_counters[c], n, memory_order_relaxed);
+}
+
+uint64_t metrics_now_ns(void);    // Monotonic clock
+
+// Add one run of command cmd (lower case, as typed) taking ns nanoseconds to
+// its latency histogram. Unknown commands share one "other" histogram.
+void metrics_record(const char *cmd, uint64_t ns);
+
+// Per-command count, p50, p99 and max, then the counters
+void metrics_report(FILE *out);
+void metrics_reset(void);
+
+// Append a report to path every interval_sec seconds until metrics_dump_stop,
+// which writes a last one. False if the file cannot be opened.
+bool metrics_dump_start(const char *path, unsigned interval_sec);
+void metrics_dump_stop(void);
+
+#endif // METRICS_H
@@ -0,0 +1,20 @@
+#ifndef POOL_H
+#define POOL_H
+#include <stddef.h>
+
+// Persistent worker threads for data-parallel scans. Workers start on first
+// use, one per online CPU beyond the caller (CMS_THREADS overrides the total).
+#define POOL_MAX_PARTS 32
+
+// Called once per part with a contiguous share [begin, end) of the work
+typedef void (*PoolFn)(void *ctx, size_t part, size_t begin, size_t end);
+
+// Split [0, n) into contiguous parts and run fn on each, the caller taking
+// part 0. Inputs under min_per_part rows per extra part stay on the calling
+// thread. Returns the number of parts, at least 1; parts cover [0, n) in order.
+size_t pool_run(size_t n, size_t min_per_part, PoolFn fn, void *ctx);
+
+// Threads available to pool_run, including the caller
+size_t pool_threads(void);
+
+#endif // POOL_H
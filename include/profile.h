@@ -0,0 +1,47 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Hardware and software event counts for one command, read with Linux
+// perf_event_open. Every thread of the process is counted, including threads
+// started while the session runs, so pool scans and load threads show up.
+// Events the kernel refuses (no PMU in a VM, perf_event_paranoid, seccomp)
+// are left out, and with none available only the elapsed time is measured.
+
+typedef enum {
+    PROFILE_CYCLES,
+    PROFILE_INSTRUCTIONS,
+    PROFILE_CACHE_MISSES,
+    PROFILE_BRANCH_MISSES,
+    PROFILE_PAGE_FAULTS,
+    PROFILE_EVENTS
+} ProfileEvent;
+
+#define PROFILE_MAX_THREADS 64
+
+typedef struct {
+    int fd[PROFILE_MAX_THREADS][PROFILE_EVENTS];   // -1 where not counting
+    size_t threads;
+    int open_errno;          // Why the first event failed to open, 0 if none did
+    uint64_t t0_ns;
+} ProfileSession;
+
+typedef struct {
+    double seconds;
+    bool valid[PROFILE_EVENTS];
+    bool scaled[PROFILE_EVENTS];     // Counter shared the PMU; value extrapolated
+    uint64_t value[PROFILE_EVENTS];
+    int open_errno;
+} ProfileResult;
+
+// Open and start the counters, then the clock
+void profile_begin(ProfileSession *p);
+
+// Stop the clock and counters, read and close them
+void profile_end(ProfileSession *p, ProfileResult *r);
+
+const char *profile_event_name(ProfileEvent e);
+
+#endif // PROFILE_H
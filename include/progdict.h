@@ -0,0 +1,20 @@
+#ifndef PROGDICT_H
+#define PROGDICT_H
+#include <stddef.h>
+#include <stdint.h>
+
+// Process-wide dictionary of programme names. Records hold a small code and
+// the text lives here once. Codes are never reused or freed.
+typedef uint16_t ProgCode;
+
+#define PROG_NONE 0           // Empty programme, also "no change" in update patches
+#define PROG_MAX_CODES 65535
+
+// Intern text (truncated to 63 bytes). Returns PROG_NONE for empty text or a full dictionary.
+ProgCode prog_intern(const char *text);
+ProgCode prog_intern_len(const char *text, size_t len);
+
+const char *prog_name(ProgCode code);   // "" for PROG_NONE
+size_t prog_count(void);                // Valid codes are 1..prog_count()
+
+#endif // PROGDICT_H
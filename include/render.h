@@ -0,0 +1,20 @@
+#ifndef RENDER_H
+#define RENDER_H
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "store.h"
+#include "version.h"
+#include "view.h"
+
+#define RENDER_ALL SIZE_MAX   // No LIMIT
+
+// Write the SHOW ALL table for rows [offset, offset + limit) of s, in store
+// order or in view order. Column widths come from the store's width counts,
+// so every page lines up and no row is measured.
+void render_table(FILE *out, const Store *s, const SortView *view, size_t offset, size_t limit);
+
+// The same table, in store order, for a pinned version
+void render_version(FILE *out, const StoreVersion *v, size_t offset, size_t limit);
+
+#endif // RENDER_H
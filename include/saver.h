@@ -0,0 +1,33 @@
+#ifndef SAVER_H
+#define SAVER_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "store.h"
+
+// Writes the database file on a background thread, so the caller can keep
+// using the live store while a copy of it goes to disk. One save runs at a
+// time.
+typedef struct {
+    bool ok;
+    uint64_t generation;    // Store generation the copy was taken at
+    size_t rows;
+    double seconds;
+} SaveResult;
+
+// Start writing copy (from store_copy_rows; the saver frees it) to path with
+// cms_save. If reset_journal is set, the database's journal is emptied once
+// the new file is in place. When report is not NULL the saver thread prints
+// a completion line there. Returns false, freeing copy, if no thread could
+// be started.
+bool saver_start(const char *path, Store *copy, uint64_t generation, bool reset_journal, FILE *report);
+
+// Wait for the running save, if any. Returns true with its result in *r (r
+// may be NULL) the first time it is called after a save finishes.
+bool saver_wait(SaveResult *r);
+
+// True while a save is still writing
+bool saver_busy(void);
+
+#endif // SAVER_H
@@ -0,0 +1,17 @@
+#ifndef SERVER_H
+#define SERVER_H
+#include <stdbool.h>
+#include "store.h"
+
+// Server mode: many local clients share one store over a Unix domain socket.
+// Clients send one command per line and get its output followed by a line
+// holding a single "." (SERVER_END). Read-only commands run concurrently under
+// a shared lock; the rest run one at a time. Each client's commands run in
+// the order sent. EXIT or QUIT closes only that client.
+#define SERVER_END ".\n"
+
+// Serve on socket_path until SIGINT or SIGTERM. False if the socket could not
+// be set up.
+bool server_run(const char *socket_path, Store *s, const char *db_path);
+
+#endif // SERVER_H
@@ -0,0 +1,14 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+#include <stdbool.h>
+#include "store.h"
+
+// Binary columnar snapshot: header, ID column, mark column and two string heaps
+// (names, programmes), protected by a CRC-32 over everything after the header.
+#define SNAPSHOT_EXT ".cmsb"
+
+bool snapshot_is_binary(const char *path);   // true if the file starts with the snapshot magic
+bool snapshot_load(const char *path, Store *s);
+bool snapshot_save(const char *path, const Store *s);
+
+#endif // SNAPSHOT_H
@@ -9,8 +9,16 @@ typedef enum {
     SORT_BY_MARK
 } SortKey;
 
-// Sort the store in-place by the specified key.
-// if asc is false, we reverse after an ascending sort.
+// Sort the store in-place by the specified key, either direction.
+// Stable: records with equal keys keep their current relative order.
 void store_sort(Store *s, SortKey key, bool asc);
 
+// Write the slots of s in sorted order to order (room for s->size) without
+// moving any record. Same ordering as store_sort; false if out of memory.
+bool store_sort_order(const Store *s, SortKey key, bool asc, size_t *order);
+
+// Stable re-sort of a full slot permutation by key: slots with equal keys keep
+// their order in the input, so sorting by ID first gives ID as the tie-break
+bool store_sort_refine(const Store *s, SortKey key, bool asc, size_t *order);
+
 #endif // SORT_H
\ No newline at end of file
@@ -3,6 +3,7 @@
 
 #include <stddef.h>
 #include "student.h"
+#include "store.h"
 
 typedef struct {
     size_t count;
@@ -12,6 +13,10 @@ typedef struct {
     int band_A, band_B, band_C, band_D, band_F;
 } Stats;
 
-Stats compute_stats(const Student *arr, size_t count);
+// Full scan over a mark column, vectorised where the CPU allows
+Stats compute_stats(const float *marks, size_t count);
+
+// Constant-time summary from the aggregates the store maintains
+Stats store_summary(const Store *s);
 
 #endif // STATS_H
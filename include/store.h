@@ -2,24 +2,151 @@
 #define STORE_H
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include "student.h"
+#include "markindex.h"
+#include "trigram.h"
 
+#define GRADE_BANDS 5        // A, B, C, D, F
+
+// Lowest mark in bands A-D; anything below GRADE_D_MIN is an F
+#define GRADE_A_MIN 85.0f
+#define GRADE_B_MIN 75.0f
+#define GRADE_C_MIN 65.0f
+#define GRADE_D_MIN 50.0f
+
+// Aggregates kept up to date by every mutation so summaries never rescan.
+// Min/max come from the mark index.
 typedef struct {
-    Student *data;
+    double sum;
+    size_t band[GRADE_BANDS];
+} StoreAgg;
+
+#define NAME_LEN 64
+
+// Rows per cell text length in each column, so a table renderer knows the
+// column widths without measuring every row. Cells are at most 63 bytes.
+#define WIDTH_BUCKETS 64
+
+typedef struct {
+    size_t id[WIDTH_BUCKETS];
+    size_t name[WIDTH_BUCKETS];
+    size_t prog[WIDTH_BUCKETS];
+    size_t mark[WIDTH_BUCKETS];    // Mark as printed with one decimal
+} StoreWidths;
+
+// Recent (mark, id) key changes, so sorted views can catch up on a few edits
+// without a full rebuild
+#define STORE_LOG_CAP 64
+
+typedef struct {
+    int id;
+    float mark;
+    bool added;         // false if the key was removed
+} StoreChange;
+
+// Rows per block when tracking which parts of the columns changed
+#define STORE_BLOCK_ROWS 4096
+
+// Column-oriented storage: slot i is (ids[i], store_name(s, i), progs[i], marks[i]).
+// Scans over one field only touch that field's column. Names live back to back
+// in one arena, so a row carries a 4-byte offset instead of a NAME_LEN buffer
+// and moving a row moves the offset, not the text.
+typedef struct {
+    int *ids;
+    float *marks;
+    uint32_t *name_off;        // Offset of each row's NUL-terminated name in name_arena
+    ProgCode *progs;
+    char *name_arena;          // Bump allocated; replaced and deleted names leave dead bytes
+    size_t arena_len;
+    size_t arena_cap;
+    size_t arena_dead;         // Bytes no row refers to, reclaimed by compaction
     size_t size;
     size_t cap;
+    unsigned *index;    // Open-addressing ID -> slot table, entries hold slot+1 (0 = empty)
+    size_t index_cap;   // Power of two, kept at least twice cap
+    StoreAgg agg;
+    StoreWidths widths;
+    MarkIndex mark_index;      // Ordered (mark, id) index for range queries and extremes
+    TrigramIndex name_grams;   // Case-folded name trigrams for CONTAINS searches
+    uint64_t generation;       // Bumped by every mutation
+    uint64_t saved_generation; // generation as last loaded from or saved to disk
+    StoreChange log[STORE_LOG_CAP];  // Ring of key changes, entry seq at log[seq % STORE_LOG_CAP]
+    uint64_t log_next;         // Sequence number of the next key change
+    uint64_t log_floor;        // Earliest replayable sequence; bulk rebuilds move it to log_next
+    uint64_t *touched;         // Bit per STORE_BLOCK_ROWS-row block written since store_clear_touched
+    bool touched_all;          // Every block counts as written (bulk loads, reorders)
 } Store;
 
 // Lifecycle
 void store_init(Store *s);
 void store_free(Store *s);
 
+// Grow capacity up front so a batch of inserts does not reallocate repeatedly
+bool store_reserve(Store *s, size_t need);
+
 // Core ops
 int store_find_index_by_id(const Store *s, int id);         // -1 if not found
 bool store_insert(Store *s, Student st);                    // false if duplicate id or invalid
 bool store_update(Store *s, int id, const Student *patch);  // patch uses sentinel values
 bool store_delete(Store *s, int id);                        // false if id not found
 
+// Whether store_insert / store_update would accept a row or patch, judging
+// every field but the programme. Callers that hold the programme as text
+// check first and intern it only for a row that will be stored.
+bool store_can_insert(const Store *s, const Student *st);
+bool store_can_update(const Store *s, int id, const Student *patch);
+
+// Record access
+Student store_get(const Store *s, size_t slot);
+static inline const char *store_name(const Store *s, size_t slot) {
+    return s->name_arena + s->name_off[slot];
+}
+
+// True if s changed since it was last loaded or saved
+static inline bool store_is_dirty(const Store *s) {
+    return s->generation != s->saved_generation;
+}
+
+// Copy only the row columns of src into dst, e.g. to write them out while src
+// keeps changing. dst has no ID, mark or name index: use it with cms_save and
+// store_free only.
+bool store_copy_rows(Store *dst, const Store *src);
+
+// Rebuild the ID index, mark index and aggregates after data has been bulk filled
+void store_reindex(Store *s);
+
+// Reorder slots so new slot i holds old slot order[i], then refresh the ID index
+bool store_apply_order(Store *s, const size_t *order);
+
+// True if a row in block b may have changed since the last store_clear_touched
+static inline bool store_block_touched(const Store *s, size_t b) {
+    return s->touched_all || ((s->touched[b / 64] >> (b % 64)) & 1);
+}
+
+void store_clear_touched(Store *s);
+
+int mark_band(float mark);   // 0 = A ... 4 = F
+
+// Longest cell in a StoreWidths column, 0 if the store is empty
+size_t store_width(const size_t hist[WIDTH_BUCKETS]);
+
+// store_insert for a row that already passed the same validators and whose ID
+// the caller has just looked up and found absent; skips both checks
+bool store_insert_trusted(Store *s, Student st);
+
+// Append n uninitialised slots for trusted bulk loads (no validation or duplicate
+// check). The new slots are [size - n, size); fill every column, set each name
+// with store_set_name, then call store_reindex.
+bool store_append_raw(Store *s, size_t n);
+
+// Set the name of a slot from store_append_raw; at most NAME_LEN - 1 bytes of
+// name[0, len) are kept. False if the arena cannot grow.
+bool store_set_name(Store *s, size_t slot, const char *name, size_t len);
+
+// Grow the name arena up front for names totalling bytes, terminators included
+bool store_reserve_names(Store *s, size_t bytes);
+
 #endif // STORE_H
 
 
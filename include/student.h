@@ -1,11 +1,12 @@
 #ifndef STUDENT_H
 #define STUDENT_H
+#include "progdict.h"
 
 // A single student record structure
 typedef struct {
     int id;
     char name[64];
-    char programme[64];
+    ProgCode programme;    // Code into the programme dictionary
     float mark;
 } Student;
 
@@ -0,0 +1,44 @@
+#ifndef TRIGRAM_H
+#define TRIGRAM_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Inverted index from lowercased 3-byte substrings to the ids containing them.
+// Posting lists are appended unsorted and sorted lazily before intersection.
+// Removals are queued per list and merged out on that lazy sort.
+#define TRIGRAM_MIN_NEEDLE 3
+
+typedef struct {
+    int *ids;
+    size_t count;
+    size_t cap;
+    bool sorted;
+    int *gone;          // Removed ids not yet purged from ids, unsorted
+    size_t n_gone;
+    size_t gone_cap;
+} Posting;
+
+typedef struct {
+    uint32_t *keys;     // Trigram code + 1, 0 marks an empty slot
+    Posting *lists;
+    size_t cap;         // Power of two
+    size_t used;
+} TrigramIndex;
+
+void trigram_init(TrigramIndex *ti);
+void trigram_free(TrigramIndex *ti);
+
+bool trigram_add(TrigramIndex *ti, const char *text, int id);
+void trigram_remove(TrigramIndex *ti, const char *text, int id);
+
+// Ids whose text contains every trigram of needle, sorted ascending; the caller
+// verifies each one and frees *out. Returns false if the needle is too short
+// to use the index or memory ran out, so the caller falls back to a scan.
+bool trigram_candidates(TrigramIndex *ti, const char *needle, int **out, size_t *count);
+
+// Upper bound on the candidates for needle: the length of its shortest
+// posting list, counting queued removals. SIZE_MAX if the needle is too short.
+size_t trigram_estimate(TrigramIndex *ti, const char *needle);
+
+#endif // TRIGRAM_H
@@ -15,16 +15,17 @@ bool str_icontains(const char *haystack, const char *needle);
 // Quote aware string tokenization
 char* smart_strtok(char **str, const char *delim, bool *in_quote_error);
 
-// Find the next key position in a string
-char* find_next_key(char *p, const char **found_keyname);
-
 // Parsing helpers
 bool parse_int(const char *s, int *out);      // Parse string to int with error checking
 bool parse_float(const char *s, float *out);  // Parse string to float with error checking
 
+// Table cell formatting without printf; dst needs 24 bytes. Returns the length.
+size_t fmt_int(char *dst, int v);
+size_t fmt_mark(char *dst, float m);          // Same text as printf("%.1f", m)
+
 // Validation helpers
 bool valid_id(int id);                        // 6-8 digit ID check
 bool valid_mark(float m);                     // 0.0 to 100.0 mark check        
-bool valid_text(const char *s);               // Non-empty text and within length check
+bool valid_text(const char *s);               // Non-empty, within length, no tab
 
 #endif // UTIL_H
\ No newline at end of file
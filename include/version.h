@@ -0,0 +1,73 @@
+#ifndef VERSION_H
+#define VERSION_H
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "store.h"
+
+// Read-only copies of the store's columns that long reads can use while
+// writers carry on. A version is split into STORE_BLOCK_ROWS-row chunks, and
+// blocks untouched since the previous version share its chunks, so a new
+// version copies only the blocks that changed.
+typedef struct {
+    int ids[STORE_BLOCK_ROWS];
+    float marks[STORE_BLOCK_ROWS];
+    ProgCode progs[STORE_BLOCK_ROWS];
+    uint32_t name_off[STORE_BLOCK_ROWS];   // Into names, laid out like the store's arena
+    char names[];                          // The chunk's names, back to back
+} VersionChunk;
+
+typedef struct {
+    uint64_t epoch;         // Publish epoch; later versions have larger epochs
+    size_t size;            // Rows, as in Store
+    size_t cap;
+    StoreWidths widths;
+    size_t n_chunks;        // Row i is chunks[i / STORE_BLOCK_ROWS]
+    VersionChunk **chunks;
+} StoreVersion;
+
+#define VERSION_MAX_READERS 64
+
+typedef struct {
+    void *ptr;
+    uint64_t epoch;         // Free once every pinned reader is at this epoch or later
+} VersionRetired;
+
+// Publishes versions of one store and frees them once no reader can see them.
+// Each pinned reader announces the epoch of its version; memory a newer
+// version no longer uses is retired with that version's epoch and freed once
+// every announced epoch has reached it (epoch-based reclamation).
+typedef struct {
+    StoreVersion *current;     // NULL until the first pin
+    uint64_t generation;       // Store generation current was taken at
+    _Atomic uint64_t readers[VERSION_MAX_READERS];  // Announced epoch, 0 = free slot
+    pthread_mutex_t publish_mu;  // Guards everything but readers
+    VersionRetired *retired;
+    size_t n_retired, retired_cap;
+} VersionDomain;
+
+typedef struct {
+    VersionDomain *d;
+    const StoreVersion *v;
+    size_t slot;
+} VersionPin;
+
+void version_domain_init(VersionDomain *d);
+void version_domain_free(VersionDomain *d);   // No reader may be pinned
+
+// Pin a version holding s as it is now, publishing one first if s changed
+// since the last. The caller must keep writers off s for the duration of the
+// call (a shared lock is enough) and may let them back in as soon as it
+// returns; the pinned version stays valid until version_unpin. Returns false
+// if memory or reader slots ran out.
+bool version_pin(VersionDomain *d, Store *s, VersionPin *pin);
+void version_unpin(VersionPin *pin);
+
+// Columns of row i in v
+static inline const VersionChunk *version_chunk(const StoreVersion *v, size_t i) {
+    return v->chunks[i / STORE_BLOCK_ROWS];
+}
+
+#endif // VERSION_H
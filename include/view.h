@@ -0,0 +1,41 @@
+#ifndef VIEW_H
+#define VIEW_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "sort.h"
+#include "store.h"
+
+// A sorted listing of the store that leaves the records where they are.
+// Rows keep their own copy of the (mark, id) key so logged edits can be
+// spliced in by binary search. Equal marks are ordered by ID ascending in
+// both directions.
+typedef struct {
+    float mark;
+    int id;
+} ViewRow;
+
+typedef struct {
+    SortKey key;
+    bool asc;
+    bool built;
+    ViewRow *rows;
+    size_t count;
+    size_t cap;
+    uint64_t generation;   // Store generation the rows reflect
+    uint64_t log_seq;      // Next store change-log entry to replay
+} SortView;
+
+// One view per (key, direction). A zeroed cache is empty and ready to use.
+typedef struct {
+    SortView views[2][2];  // [SortKey][asc]
+} SortViewCache;
+
+// Drop every view, e.g. when the store is reloaded
+void view_cache_reset(SortViewCache *c);
+
+// The view of s in the given order, brought up to date by replaying the
+// store's change log or, past that, rebuilt. NULL if out of memory.
+const SortView *view_cache_get(SortViewCache *c, const Store *s, SortKey key, bool asc);
+
+#endif // VIEW_H
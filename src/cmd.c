@@ -2,12 +2,88 @@
 #include <string.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <pthread.h>
+#include <math.h>
 
 #include "cmd.h"
+#include "find.h"
 #include "io.h"
+#include "journal.h"
+#include "kvparse.h"
+#include "metrics.h"
+#include "profile.h"
+#include "render.h"
+#include "saver.h"
 #include "stats.h"
 #include "sort.h"
 #include "util.h"
+#include "view.h"
+
+// Journal of changes since the last SAVE. It is attached once the in-memory store
+// mirrors the database file (after OPEN or a full SAVE); until then SAVE rewrites the file.
+static Journal g_journal;
+static bool g_journal_attached = false;
+static SortViewCache g_views;   // Sorted listings for SHOW ... SORT BY
+static pthread_mutex_t g_views_lock = PTHREAD_MUTEX_INITIALIZER; // Readers refresh views concurrently
+static bool g_batch = false;    // Scripted run: no confirmation prompts
+
+void cmd_set_batch(bool batch) {
+    g_batch = batch;
+}
+
+static void attach_journal(const char *db_path) {
+    journal_free(&g_journal);
+    journal_init(&g_journal, db_path);
+    g_journal_attached = true;
+}
+
+// Wait for a background save and take its result. A failed rewrite leaves the
+// journal without the base file it was started against, so detach it and let
+// the next SAVE rewrite the file instead. The saver thread reports to the
+// console itself; a shared store has no console, so the failure goes to the
+// client whose command collects it (ctx may be NULL outside a command).
+static void collect_save(const CmdContext *ctx, Store *s, const char *db_path) {
+    SaveResult r;
+    if (!saver_wait(&r)) {
+        return;
+    }
+    if (r.ok) {
+        s->saved_generation = r.generation;
+    } else {
+        g_journal_attached = false;
+        if (ctx && ctx->shared) {
+            fprintf(ctx->err, "Background save to %s failed; changes are still unsaved.\n", db_path);
+        }
+    }
+}
+
+static void journal_queue_failed(const CmdContext *ctx) {
+    fprintf(ctx->err, "Warning: out of memory while journaling change; use COMPACT to persist it.\n");
+}
+
+// Store locking for callers that share it; no-ops for one that owns it
+static void lock_shared(const CmdContext *ctx) {
+    if (ctx->shared) pthread_rwlock_rdlock(&ctx->shared->lock);
+}
+
+static void lock_exclusive(const CmdContext *ctx) {
+    if (ctx->shared) pthread_rwlock_wrlock(&ctx->shared->lock);
+}
+
+static void unlock_store(const CmdContext *ctx) {
+    if (ctx->shared) pthread_rwlock_unlock(&ctx->shared->lock);
+}
+
+// Pin the current version of s, then let writers back in. The caller holds
+// the shared lock, which this releases either way.
+static bool pin_version(const CmdContext *ctx, Store *s, VersionPin *pin) {
+    bool ok = version_pin(&ctx->shared->versions, s, pin);
+    unlock_store(ctx);
+    if (!ok) {
+        fprintf(ctx->err, "Error: Out of memory while taking a snapshot.\n");
+    }
+    return ok;
+}
 
 static void init_patch(Student *patch) {
     memset(patch, 0, sizeof(Student));
@@ -15,25 +91,25 @@ static void init_patch(Student *patch) {
     patch->mark = -1.0f;   // Sentinel for no change
 }
 
-static bool has_no_args(char *args, const char *cmd_name) {
+static bool has_no_args(const CmdContext *ctx, char *args, const char *cmd_name) {
     if (args) {
         str_trim(args);
         if (args[0] != '\0') {
-            fprintf(stderr, "%s command does not take any arguments.\n", cmd_name);
+            fprintf(ctx->err, "%s command does not take any arguments.\n", cmd_name);
             return false;
         }
     }
     return true;
 }
 
-static bool parse_single_id_command(char *args, const char *cmd_name, int *out_id) {
+static bool parse_single_id_command(const CmdContext *ctx, char *args, const char *cmd_name, int *out_id) {
     if (!args) {
-        fprintf(stderr, "%s command requires ID argument.\n", cmd_name);
+        fprintf(ctx->err, "%s command requires ID argument.\n", cmd_name);
         return false;
     }
     
     if (strncasecmp(args, "ID=", 3) != 0) {
-        fprintf(stderr, "%s command requires ID argument in format ID=<value>.\n", cmd_name);
+        fprintf(ctx->err, "%s command requires ID argument in format ID=<value>.\n", cmd_name);
         return false;
     }
 
@@ -44,19 +120,19 @@ static bool parse_single_id_command(char *args, const char *cmd_name, int *out_i
     long value = strtol(value_str, &endptr, 10);
 
     if (endptr == value_str) {
-        fprintf(stderr, "No ID value provided for %s command.\n", cmd_name);
+        fprintf(ctx->err, "No ID value provided for %s command.\n", cmd_name);
         return false;
     }
 
     while (*endptr && isspace((unsigned char)*endptr)) endptr++; // Skip trailing whitespace
 
     if (*endptr != '\0') {
-        fprintf(stderr, "Unexpected characters after ID value in %s command.\n", cmd_name);
+        fprintf(ctx->err, "Unexpected characters after ID value in %s command.\n", cmd_name);
         return false;
     }
 
     if (!valid_id((int)value)) {
-        fprintf(stderr, "Invalid ID value for %s command. Must be 6-8 digits.\n", cmd_name);
+        fprintf(ctx->err, "Invalid ID value for %s command. Must be 6-8 digits.\n", cmd_name);
         return false;
     }
 
@@ -64,145 +140,106 @@ static bool parse_single_id_command(char *args, const char *cmd_name, int *out_i
     return true;
 }
 
-static void show_all(const Store *s){
-    if (s->size == 0) {
-        puts("No records.");
-        return;
+// Read the count after a LIMIT or OFFSET keyword in args, if present
+static bool parse_paging_value(const CmdContext *ctx, const char *args, const char *keyword, size_t *out) {
+    const char *p = args ? str_icase_find(args, keyword) : NULL;
+    if (!p) {
+        return true;
     }
-    // Dynamically compute column widths based on data + header
-    size_t id_w = strlen("ID");
-    size_t name_w = strlen("Name");
-    size_t prog_w = strlen("Programme");
-    size_t mark_w = strlen("Mark");
-    char tmp[64];
-
-    for (size_t i = 0; i < s->size; ++i) {
-        const Student *st = &s->data[i];
-        // ID width
-        int n = snprintf(tmp, sizeof tmp, "%d", st->id);
-        if (n > 0 && (size_t)n > id_w) id_w = (size_t)n;
-        // Name width
-        size_t ln = strlen(st->name);
-        if (ln > name_w) name_w = ln;
-        // Programme width
-        size_t lp = strlen(st->programme);
-        if (lp > prog_w) prog_w = lp;
-        // Mark width (one decimal place)
-        n = snprintf(tmp, sizeof tmp, "%.1f", st->mark);
-        if (n > 0 && (size_t)n > mark_w) mark_w = (size_t)n;
-    }
-
-    // Cast widths to int for printf field widths (safe for normal table sizes)
-    int iw = (int)id_w;
-    int nw = (int)name_w;
-    int pw = (int)prog_w;
-    int mw = (int)mark_w;
-
-    printf("size=%zu cap=%zu\n", s->size, s->cap);
-    printf("%-*s  %-*s  %-*s  %*s\n", iw, "ID", nw, "Name", pw, "Programme", mw, "Mark");
-    for (size_t i = 0; i < s->size; ++i) {
-        const Student *st = &s->data[i];
-        printf("%*d  %-*s  %-*s  %*.1f\n",
-               iw, st->id,
-               nw, st->name,
-               pw, st->programme,
-               mw, st->mark);
+    p += strlen(keyword);
+    while (isspace((unsigned char)*p)) p++;
+    if (!isdigit((unsigned char)*p)) {
+        fprintf(ctx->err, "Error: %s requires a non-negative number.\n", keyword);
+        return false;
     }
-    puts("");
+    char *end = NULL;
+    unsigned long long v = strtoull(p, &end, 10);
+    if (*end != '\0' && !isspace((unsigned char)*end)) {
+        fprintf(ctx->err, "Error: Invalid number for %s.\n", keyword);
+        return false;
+    }
+    *out = (size_t)v;
+    return true;
 }
 
-static bool handle_find(char *args, Store *s) {
-    char *column = strtok(args, " ");
-    char *op = strtok(NULL, " ");
-    char *value = strtok(NULL, "");
-
-    if (!column || !op || !value) { // Missing arguments
-        fprintf(stderr, "Error: FIND requires 3 arguments. Syntax: FIND <Column> <Operator> <Value>\n");
-        fprintf(stderr, "Example: FIND Name CONTAINS \"Wang\"\n");
-        fprintf(stderr, "Example: FIND Mark > 75\n");
+static bool handle_find(const CmdContext *ctx, char *args, Store *s) {
+    if (args[strspn(args, " \t\r\n")] == '\0') {
+        fprintf(ctx->err, "Error: FIND requires an expression. Syntax: FIND <Column> <Operator> <Value> [AND|OR ...]\n");
+        fprintf(ctx->err, "Example: FIND Name CONTAINS \"Wang\"\n");
+        fprintf(ctx->err, "Example: FIND Programme = CS AND (Mark >= 85 OR NOT Mark > 40)\n");
         return false;
     }
 
-    str_trim(column); str_tolower(column);
-    str_trim(op); str_tolower(op);
-    str_trim(value);
-
-    size_t len = strlen(value);
-    if (len >= 2 && value[0] == '"' && value[len - 1] == '"') {
-        // Remove surrounding quotes
-        value[len - 1] = '\0';
-        memmove(value, value + 1, len - 1);
+    FindQuery *q = find_compile(args, ctx->err);
+    if (!q) {
+        return false;
     }
 
-    float mark_value = 0.0f;
-    bool num_filter = false;
-    if (strcmp(column, "mark") == 0) {
-        if (!parse_float(value, &mark_value)) {
-            fprintf(stderr, "Error: Invalid mark value for FIND command: %s\n", value);
-            return false;
+    // Index lookups finish quickly under the lock; scans read a version
+    bool ok = false;
+    lock_shared(ctx);
+    if (!ctx->shared || find_is_point(q, s)) {
+        ok = find_run(ctx->out, ctx->err, q, s);
+        unlock_store(ctx);
+    } else {
+        VersionPin pin;
+        if (pin_version(ctx, s, &pin)) {
+            ok = find_run_version(ctx->out, ctx->err, q, pin.v);
+            version_unpin(&pin);
         }
-        num_filter = true;
     }
+    find_free(q);
+    return ok;
+}
 
-    int match_count = 0;
-    for (size_t i = 0; i<s->size; i++) {
-        const Student *st = &s->data[i];
-        bool match = false;
+// SHOW [ALL] [SORT BY ID|MARK [ASC|DESC]] [LIMIT n] [OFFSET m] | SHOW SUMMARY
+static void handle_show(const CmdContext *ctx, char *args, Store *s) {
+    if (args && strncasecmp(args, "summary", 7) == 0) {
+        lock_shared(ctx);
+        Stats st = store_summary(s);
+        fprintf(ctx->out, "Total: %zu\nAverage: %.2f\nHighest: %.2f", st.count, st.average, st.max_mark);
+        if (st.max_idx >= 0) fprintf(ctx->out, " (%s)\n", store_name(s, (size_t)st.max_idx)); else fputc('\n', ctx->out);
+        fprintf(ctx->out, "Lowest: %.2f", st.min_mark);
+        if (st.min_idx >= 0) fprintf(ctx->out, " (%s)\n", store_name(s, (size_t)st.min_idx)); else fputc('\n', ctx->out);
+        fprintf(ctx->out, "Grade bands - A:%d B:%d C:%d D:%d F:%d\n", st.band_A, st.band_B, st.band_C, st.band_D, st.band_F);
+        unlock_store(ctx);
+        return;
+    }
 
-        if (strcmp(column, "name") == 0) {
-            if (strcmp(op, "=") == 0) {
-                match = str_ieq(st->name, value);
-            } else if (strcmp(op, "contains") == 0) {
-                match = (str_icase_find(st->name, value) != NULL);
-            } else {
-                fprintf(stderr, "Error: Unsupported operator for Name column: %s\n", op);
-                return false;
-            }
-        } else if (strcmp(column, "programme") == 0) {
-            if (strcmp(op, "=") == 0) {
-                match = str_ieq(st->name, value);
-            } else if (strcmp(op, "contains") == 0) {
-                match = (str_icase_find(st->programme, value) != NULL);
-            } else {
-                fprintf(stderr, "Error: Unsupported operator for Programme column: %s\n", op);
-                return false;
-            }
-        } else if (strcmp(column, "mark") == 0) {
-            if (strcmp(op, "=") == 0) {
-                match = (st->mark >= mark_value - 0.01f && st->mark <= mark_value + 0.01f);
-            } else if (strcmp(op, ">") == 0) {
-                match = (st->mark > mark_value);
-            } else if (strcmp(op, "<") == 0) {
-                match = (st->mark < mark_value);
-            } else if (strcmp(op, ">=") == 0) {
-                match = (st->mark >= mark_value);
-            } else if (strcmp(op, "<=") == 0) {
-                match = (st->mark <= mark_value);
-            } else {
-                fprintf(stderr, "Error: Unsupported operator for Mark column: %s\n", op);
-                return false;
-            }
-        } else {
-            fprintf(stderr, "Error: Unsupported column for FIND command: %s\nUse Name, Programme, Mark.\n", column);
-        }
+    // maybe has sorting clause
+    bool sorted = false, asc = true; SortKey key = SORT_BY_ID;
+    if (args && str_icontains(args, "sort by")) {
+        sorted = true;
+        if (str_icontains(args, "mark")) key = SORT_BY_MARK;
+        if (str_icontains(args, "desc")) asc = false;
+    }
+    size_t offset = 0, limit = RENDER_ALL;
+    if (!parse_paging_value(ctx, args, "LIMIT", &limit) || !parse_paging_value(ctx, args, "OFFSET", &offset)) {
+        return;
+    }
 
-        if (match) {
-            if (match_count == 0) {
-                // Print header on first match
-                printf("ID\tName\tProgramme\tMark\n");
-            }
-            printf("%d\t%s\t%s\t%.2f\n", st->id, st->name, st->programme, st->mark);
-            match_count++;
+    lock_shared(ctx);
+    if (ctx->shared && !sorted) {
+        // A full listing reads a version so it does not hold up writers
+        VersionPin pin;
+        if (pin_version(ctx, s, &pin)) {
+            render_version(ctx->out, pin.v, offset, limit);
+            version_unpin(&pin);
         }
+        return;
     }
-
-    if (match_count == 0) {
-        puts("No matching records found.");
+    const SortView *view = NULL;
+    if (sorted) {
+        pthread_mutex_lock(&g_views_lock);
+        view = view_cache_get(&g_views, s, key, asc);
+        pthread_mutex_unlock(&g_views_lock);
+    }
+    if (sorted && !view) {
+        fprintf(ctx->err, "Error: Out of memory while sorting records.\n");
     } else {
-        printf("Total matches: %d\n", match_count);
+        render_table(ctx->out, s, view, offset, limit);
     }
-    
-    return true;
+    unlock_store(ctx);
 }
 
 // static bool parse_kv(char *token, Student *patch) {
@@ -248,186 +285,82 @@ static bool handle_find(char *args, Store *s) {
 //     return false;
 // }
 
-static bool handle_insert(char *args, Store *s) {
-    printf("Insert args: %s\n", args);
+static bool handle_insert(const CmdContext *ctx, char *args, Store *s) {
+    fprintf(ctx->out, "Insert args: %s\n", args);
     Student patch;
+    char programme[KV_PROG_LEN] = "";
     init_patch(&patch);
 
-    char *p = args;
-    while (p && *p) {
-        const char *key_name= NULL;
-        char *key_start = find_next_key(p, &key_name); // Find start of next key
-        if (!key_start) {
-            break;
-        }
-
-        char *eq = strchr(key_start + strlen(key_name), '=');
-
-        char *check_ptr = key_start + strlen(key_name);
-        while(check_ptr < eq && isspace((unsigned char)*check_ptr)) {
-            check_ptr++;
-        }
-
-        if (!eq || check_ptr != eq) {
-            fprintf(stderr, "Malformed key-value pair: Missing or invalid '=' after key %s.\n", key_start);
-            return false;
-        }
-
-        char *value_start = eq + 1;
-        while (*value_start && isspace((unsigned char)*value_start)) value_start++;
-
-        const char *next_key = NULL;
-        char *value_end = find_next_key(value_start, &next_key); // Find start of next key or the end of string
-
-        char value_buf[256];
-        size_t len;
-        if (value_end == NULL) {
-            len = strlen(value_start);
-            p = NULL; // End of string
-        } else {
-            len = value_end - value_start;
-            p = value_end;
-        }
-
-        if (len > sizeof(value_buf)-1) len = sizeof(value_buf)-1;
-        strncpy(value_buf, value_start, len);
-        value_buf[len] = '\0';
-        str_trim(value_buf);
-
-        size_t value_len = strlen(value_buf);
-        if (value_len > 2 && value_buf[0] == '"' && value_buf[value_len - 1] == '"') {
-            // Remove surrounding quotes
-            value_buf[value_len - 1] = '\0';
-            memmove(value_buf, value_buf + 1, value_len - 1);
-        }
-
-        if (str_ieq(key_name, "ID")) {
-            if(!parse_int(value_buf, &patch.id)) {
-                fprintf(stderr, "Invalid ID value: %s\n", value_buf);
-                return false;
-            }
-        } else if (str_ieq(key_name, "Name")) {
-            strncpy(patch.name, value_buf, sizeof(patch.name));
-            patch.name[sizeof(patch.name) - 1] = '\0';
-        } else if (str_ieq(key_name, "Programme")) {
-            strncpy(patch.programme, value_buf, sizeof(patch.programme));
-            patch.programme[sizeof(patch.programme) - 1] = '\0';
-        } else if (str_ieq(key_name, "Mark")) {
-            if (!parse_float(value_buf, &patch.mark)) {
-                fprintf(stderr, "Invalid Mark value: %s\n", value_buf);
-                return false;
-            }
-        }
+    if (!kv_parse_student(args, &patch, programme, ctx->err)) {
+        return false;
     }
 
-    printf("Parsed Insert - ID: %d, Name: %s, Programme: %s, Mark: %.2f\n",
-           patch.id, patch.name, patch.programme, patch.mark);
+    fprintf(ctx->out, "Parsed Insert - ID: %d, Name: %s, Programme: %s, Mark: %.2f\n",
+            patch.id, patch.name, programme, patch.mark);
 
     // Validate all fields are provided
-    if (patch.id < 0 || patch.name[0] == '\0' || patch.programme[0] == '\0' || patch.mark < 0.0f) {
-        fprintf(stderr, "INSERT requires ID, Name, Programme, Mark.\n");
+    if (patch.id < 0 || patch.name[0] == '\0' || programme[0] == '\0' || patch.mark < 0.0f) {
+        fprintf(ctx->err, "INSERT requires ID, Name, Programme, Mark.\n");
         return false;
     }
 
-    if (!store_insert(s, patch)) {
-        fprintf(stderr, "Failed to insert record. Possible duplicate ID or invalid data.\n");
+    // The programme dictionary never shrinks, so only a row that will be
+    // stored may add to it
+    bool ok = store_can_insert(s, &patch);
+    if (ok) {
+        patch.programme = prog_intern(programme);
+        ok = store_insert(s, patch);
+    }
+    if (!ok) {
+        fprintf(ctx->err, "Failed to insert record. Possible duplicate ID or invalid data.\n");
         return false;
     }
+    if (g_journal_attached && !journal_log_insert(&g_journal, &patch)) {
+        journal_queue_failed(ctx);
+    }
 
-    puts("Record successfully inserted.");
+    fputs("Record successfully inserted.\n", ctx->out);
     return true;
 }
 
-static bool handle_update(char *args, Store *s) {
+static bool handle_update(const CmdContext *ctx, char *args, Store *s) {
     Student patch;
+    char programme[KV_PROG_LEN] = "";
     init_patch(&patch);
 
-    char *p = args;
-    while (p && *p) {
-        const char *key_name= NULL;
-        char *key_start = find_next_key(p, &key_name); // Find start of next key
-        if (!key_start) {
-            break;
-        }
-
-        char *eq = strchr(key_start + strlen(key_name), '=');
-
-        char *check_ptr = key_start + strlen(key_name);
-        while(check_ptr < eq && isspace((unsigned char)*check_ptr)) {
-            check_ptr++;
-        }
-
-        if (!eq || check_ptr != eq) {
-            fprintf(stderr, "Malformed key-value pair: Missing or invalid '=' after key %s.\n", key_start);
-            return false;
-        }
-
-        char *value_start = eq + 1;
-        while (*value_start && isspace((unsigned char)*value_start)) value_start++;
-
-        const char *next_key = NULL;
-        char *value_end = find_next_key(value_start, &next_key); // Find start of next key or the end of string
-
-        char value_buf[256];
-        size_t len;
-        if (value_end == NULL) {
-            len = strlen(value_start);
-            p = NULL; // End of string
-        } else {
-            len = value_end - value_start;
-            p = value_end;
-        }
-
-        if (len > sizeof(value_buf)-1) len = sizeof(value_buf)-1;
-        strncpy(value_buf, value_start, len);
-        value_buf[len] = '\0';
-        str_trim(value_buf);
-
-        size_t value_len = strlen(value_buf);
-        if (value_len > 2 && value_buf[0] == '"' && value_buf[value_len - 1] == '"') {
-            // Remove surrounding quotes
-            value_buf[value_len - 1] = '\0';
-            memmove(value_buf, value_buf + 1, value_len - 1);
-        }
-
-        if (str_ieq(key_name, "ID")) {
-            if(!parse_int(value_buf, &patch.id)) {
-                fprintf(stderr, "Invalid ID value: %s\n", value_buf);
-                return false;
-            }
-        } else if (str_ieq(key_name, "Name")) {
-            strncpy(patch.name, value_buf, sizeof(patch.name));
-            patch.name[sizeof(patch.name) - 1] = '\0';
-        } else if (str_ieq(key_name, "Programme")) {
-            strncpy(patch.programme, value_buf, sizeof(patch.programme));
-            patch.programme[sizeof(patch.programme) - 1] = '\0';
-        } else if (str_ieq(key_name, "Mark")) {
-            if (!parse_float(value_buf, &patch.mark)) {
-                fprintf(stderr, "Invalid Mark value: %s\n", value_buf);
-                return false;
-            }
-        }
+    if (!kv_parse_student(args, &patch, programme, ctx->err)) {
+        return false;
     }
 
-    printf("Parsed Update - ID: %d, Name: %s, Programme: %s, Mark: %.2f\n",
-           patch.id, patch.name, patch.programme, patch.mark);
+    fprintf(ctx->out, "Parsed Update - ID: %d, Name: %s, Programme: %s, Mark: %.2f\n",
+            patch.id, patch.name, programme, patch.mark);
 
     if (patch.id < 0) {
-        fprintf(stderr, "UPDATE requires existing ID to identify record.\n");
+        fprintf(ctx->err, "UPDATE requires existing ID to identify record.\n");
         return false;
     }
 
-    if (patch.name[0] == '\0' && patch.programme[0] == '\0' && patch.mark < 0.0f) {
+    if (patch.name[0] == '\0' && programme[0] == '\0' && patch.mark < 0.0f) {
         // Only an ID was provided.
-        printf("Warning: UPDATE command given with only an ID. No fields to update.\n");
+        fprintf(ctx->out, "Warning: UPDATE command given with only an ID. No fields to update.\n");
     }
 
-    if (!store_update(s, patch.id, &patch)) {
-        fprintf(stderr, "Failed to update record. Possible invalid data or ID not found.\n");
+    // As for INSERT, intern the programme only once the rest of the patch passes;
+    // a full dictionary must fail the update rather than read as "no change"
+    bool ok = store_can_update(s, patch.id, &patch);
+    if (ok && programme[0] != '\0') {
+        patch.programme = prog_intern(programme);
+        ok = patch.programme != PROG_NONE;
+    }
+    if (!ok || !store_update(s, patch.id, &patch)) {
+        fprintf(ctx->err, "Failed to update record. Possible invalid data or ID not found.\n");
         return false;
     }
+    if (g_journal_attached && !journal_log_update(&g_journal, patch.id, &patch)) {
+        journal_queue_failed(ctx);
+    }
 
-    puts("Record successfully updated.");
+    fputs("Record successfully updated.\n", ctx->out);
     return true;
 }
 
@@ -445,12 +378,12 @@ static bool handle_update(char *args, Store *s) {
     If the user confirms the deletion , the code will return true after deleting the record.
     If the user cancels the deletion or if any error occurs, the code will return false.
 */ 
-static bool handle_delete(char *args, Store *s) {
+static bool handle_delete(const CmdContext *ctx, char *args, Store *s) {
     int id;
 
     // Extracting ID from the arguments , will pull out number after "ID=".
     // If parsing fails, return false.
-    if (!parse_single_id_command(args, "DELETE", &id)) {
+    if (!parse_single_id_command(ctx, args, "DELETE", &id)) {
         return false; 
     }
 
@@ -458,139 +391,215 @@ static bool handle_delete(char *args, Store *s) {
     //Check if the ID exists in the database.
     //If not found, print error message and return false.
     if (store_find_index_by_id(s, id) < 0) {
-        fprintf(stderr, "ID %d not found.\n", id);
+        fprintf(ctx->err, "ID %d not found.\n", id);
         return false;
     }
 
-    //Prompt user for confirmation before deletion.
-    printf("Are you sure you want to delete ID %d? (Y/N): ", id);
-    fflush(stdout);
+    //Prompt user for confirmation before deletion, unless running a script
+    //whose input is the next command rather than an answer.
+    if (!ctx->batch) {
+        fprintf(ctx->out, "Are you sure you want to delete ID %d? (Y/N): ", id);
+        fflush(ctx->out);
 
-    // Read user input for confirmation.
-    char buf[16];
-    if (!fgets(buf, sizeof buf, stdin)) {
-        return false;
-    }
+        // Read user input for confirmation.
+        char buf[16];
+        if (!fgets(buf, sizeof buf, stdin)) {
+            return false;
+        }
 
-    if (buf[0] != 'Y' && buf[0] != 'y') {
-        puts("Delete operation cancelled.");
-        return false;
+        if (buf[0] != 'Y' && buf[0] != 'y') {
+            fputs("Delete operation cancelled.\n", ctx->out);
+            return false;
+        }
     }
     // Attempt to delete the record with the specified ID from the database.
     // If failed to delete , it will print an error message and return false to try again.
     if (!store_delete(s, id)) {
-        fprintf(stderr, "Failed to delete record with ID %d.\n", id);
+        fprintf(ctx->err, "Failed to delete record with ID %d.\n", id);
         return false;
     }
+    if (g_journal_attached && !journal_log_delete(&g_journal, id)) {
+        journal_queue_failed(ctx);
+    }
 
-    puts("Record successfully deleted.");
+    fputs("Record successfully deleted.\n", ctx->out);
     return true;
 }
 
-static bool handle_query(char *args, const Store *s) {
+static bool handle_query(const CmdContext *ctx, char *args, const Store *s) {
     int id;
-    if (!parse_single_id_command(args, "QUERY", &id)) {
+    if (!parse_single_id_command(ctx, args, "QUERY", &id)) {
         return false;
     }
 
     if (id <= 0) {
-        fputs("QUERY requires ID=...\n", stderr);
+        fputs("QUERY requires ID=...\n", ctx->err);
         return false; 
     }
 
     int idx = store_find_index_by_id(s, id);
     if (idx < 0) {
-        puts("Record does not exist.");
+        fputs("Record does not exist.\n", ctx->out);
         return false; 
     }
     
-    const Student *st = &s->data[idx];
-    printf("%d\t%s\t%s\t%.2f\n", st->id, st->name, st->programme, st->mark);
+    fprintf(ctx->out, "%d\t%s\t%s\t%.2f\n", s->ids[idx], store_name(s, (size_t)idx), prog_name(s->progs[idx]), s->marks[idx]);
     return true;
 }
 
-bool cmd_process_line(const char *line_in, Store *s, const char *db_path) {
-    // Make a modifiable copy of the input line
-    char line[512];
-    strncpy(line, line_in, sizeof(line));
-    line[sizeof(line) - 1] = '\0';
-
-    //split commands and arguments
-    char *p = line;
-    while (*p && !isspace((unsigned char)*p)) p++;
-    char *cmd = line;
-    char *args = NULL;
-    if (*p) {
-        *p = '\0';
-        args = p + 1;
-    }
-    str_tolower(cmd);
-
+static bool run_command(const CmdContext *ctx, char *cmd, char *args, Store *s, const char *db_path) {
     if (strcmp(cmd, "open") == 0) {
-        if (!has_no_args(args, "OPEN")) {
+        if (!has_no_args(ctx, args, "OPEN")) {
             return true;
         }
 
         int skipped = 0;
+        collect_save(ctx, s, db_path);
         store_free(s);
         store_init(s);
+        view_cache_reset(&g_views);
+        g_journal_attached = false;
         if (cms_load(db_path, s, &skipped)) {
-            printf("Database loaded. Total %zu records, skipped %d line(s).\n", s->size, skipped);
+            attach_journal(db_path);
+            size_t applied = 0, failed = 0;
+            if (!journal_replay(&g_journal, s, &applied, &failed)) {
+                fprintf(ctx->err, "Failed to replay journal %s\n", g_journal.path);
+            }
+            s->saved_generation = s->generation;
+            fprintf(ctx->out, "Database loaded. Total %zu records, skipped %d line(s).\n", s->size, skipped);
+            if (applied || failed) {
+                fprintf(ctx->out, "Replayed %zu journal record(s), %zu no longer applied.\n", applied, failed);
+            }
         } else {
-            fprintf(stderr, "Failed to load database from %s\n", db_path);
+            fprintf(ctx->err, "Failed to load database from %s\n", db_path);
         }
 
         return true;
     }
 
-    if (strcmp(cmd, "save") == 0) {
-        if (!has_no_args(args, "SAVE")) {
+    if (strcmp(cmd, "save") == 0 || strcmp(cmd, "compact") == 0) {
+        bool compact = strcmp(cmd, "compact") == 0;
+        if (!has_no_args(ctx, args, compact ? "COMPACT" : "SAVE")) {
+            return true;
+        }
+
+        collect_save(ctx, s, db_path);
+        if (!compact && !store_is_dirty(s)) {
+            fprintf(ctx->out, "No changes to save.\n");
+            return true;
+        }
+
+        // Append only the changes when the file already holds everything else
+        if (!compact && g_journal_attached) {
+            size_t changes = g_journal.pending;
+            if (journal_commit(&g_journal)) {
+                s->saved_generation = s->generation;
+                fprintf(ctx->out, "Database saved to %s (%zu change(s) journaled)\n", db_path, changes);
+            } else {
+                fprintf(ctx->err, "Failed to write journal %s\n", g_journal.path);
+            }
+            return true;
+        }
+
+        // Fold everything into the base file on the saver thread, then start an
+        // empty journal. Changes made meanwhile are journaled against the new file.
+        Store copy;
+        if (!store_copy_rows(&copy, s)) {
+            fprintf(ctx->err, "Error: Out of memory while saving.\n");
+            return true;
+        }
+        size_t rows = copy.size;
+        bool background = !ctx->batch || ctx->shared;
+        attach_journal(db_path);
+        FILE *report = background && !ctx->shared ? stdout : NULL;
+        if (!saver_start(db_path, &copy, s->generation, true, report)) {
+            g_journal_attached = false;
+            fprintf(ctx->err, "Failed to save database to %s\n", db_path);
+            return true;
+        }
+        if (background) {
+            fprintf(ctx->out, "Saving %zu record(s) to %s in the background.\n", rows, db_path);
             return true;
         }
 
-        if (cms_save(db_path, s)) {
-            printf("Database saved to %s\n", db_path);
+        // Scripts wait, so their output stays in command order
+        collect_save(ctx, s, db_path);
+        if (g_journal_attached) {
+            fprintf(ctx->out, "Database saved to %s\n", db_path);
         } else {
-            fprintf(stderr, "Failed to save database to %s\n", db_path);
+            fprintf(ctx->err, "Failed to save database to %s\n", db_path);
         }
 
         return true;
     }
 
-    if (strcmp(cmd, "show") == 0) {
-        // SHOW [ALL] [SORT BY ID|MARK [ASC|DESC]] | SHOW SUMMARY
-        if (!args || strncasecmp(args, "summary", 7) != 0) {
-        // maybe has sorting clause
-        bool sorted = false, asc = true; SortKey key = SORT_BY_ID;
-        if (args && str_icontains(args, "sort by")) {
-        sorted = true;
-        if (str_icontains(args, "mark")) key = SORT_BY_MARK;
-        if (str_icontains(args, "desc")) asc = false;
+    if (strcmp(cmd, "convert") == 0) {
+        char *src = args ? strtok(args, " \t") : NULL;
+        char *dst = src ? strtok(NULL, " \t") : NULL;
+        if (!src || !dst || strtok(NULL, " \t")) {
+            fprintf(ctx->err, "CONVERT requires source and destination files. Syntax: CONVERT <src> <dst>\n");
+            return true;
         }
-        if (sorted) store_sort(s, key, asc);
-        show_all(s);
-        
+
+        size_t rows = 0;
+        int skipped = 0;
+        if (cms_convert(src, dst, &rows, &skipped)) {
+            fprintf(ctx->out, "Converted %zu records from %s to %s, skipped %d line(s).\n", rows, src, dst, skipped);
         } else {
-            Stats st = compute_stats(s->data, s->size);
-            printf("Total: %zu\nAverage: %.2f\nHighest: %.2f", st.count, st.average, st.max_mark);
-            if (st.max_idx >= 0) printf(" (%s)\n", s->data[st.max_idx].name); else puts("");
-            printf("Lowest: %.2f", st.min_mark);
-            if (st.min_idx >= 0) printf(" (%s)\n", s->data[st.min_idx].name); else puts("");
-            printf("Grade bands - A:%d B:%d C:%d D:%d F:%d\n", st.band_A, st.band_B, st.band_C, st.band_D, st.band_F);
+            fprintf(ctx->err, "Failed to convert %s to %s\n", src, dst);
+        }
+
+        return true;
+    }
+
+    if (strcmp(cmd, "import") == 0) {
+        char *path = args ? strtok(args, " \t") : NULL;
+        if (!path || strtok(NULL, " \t")) {
+            fprintf(ctx->err, "IMPORT requires a file. Syntax: IMPORT <file>\n");
+            return true;
+        }
+
+        size_t base = s->size;
+        ImportReport rep;
+        if (!cms_import(path, s, &rep)) {
+            fprintf(ctx->err, "Failed to import %s\n", path);
+            return true;
+        }
+        // Journal the appended rows so SAVE persists them like single INSERTs
+        for (size_t i = base; g_journal_attached && i < s->size; i++) {
+            Student st = store_get(s, i);
+            if (!journal_log_insert(&g_journal, &st)) {
+                journal_queue_failed(ctx);
+                break;
+            }
+        }
+
+        size_t rejected = 0;
+        for (int r = 0; r < IMPORT_REASONS; r++) rejected += rep.rejected[r];
+        fprintf(ctx->out, "Imported %zu record(s) from %s, rejected %zu.\n", rep.added, path, rejected);
+        for (int r = 0; r < IMPORT_REASONS; r++) {
+            if (rep.rejected[r]) {
+                fprintf(ctx->out, "  %-24s %8zu  (first at line %zu)\n",
+                        import_reason_name((ImportReason)r), rep.rejected[r], rep.first_line[r]);
+            }
         }
+        return true;
+    }
 
+    if (strcmp(cmd, "show") == 0) {
+        handle_show(ctx, args, s);
         return true;
     }
 
     if (strcmp(cmd, "insert") == 0) {
-        if (!handle_insert(args ? args : "", s)) {
+        if (!handle_insert(ctx, args ? args : "", s)) {
             // Error printing handled in handler
         }
 
         return true;
     }
     if (strcmp(cmd, "update") == 0) {
-        if (!handle_update(args ? args : "", s)) {
+        if (!handle_update(ctx, args ? args : "", s)) {
             // Error printing handled in handler
         }
 
@@ -598,7 +607,7 @@ bool cmd_process_line(const char *line_in, Store *s, const char *db_path) {
     }
 
     if (strcmp(cmd, "delete") == 0) {
-        if (!handle_delete(args ? args : "", s)) {
+        if (!handle_delete(ctx, args ? args : "", s)) {
             // Error printing handled in handler
         }
 
@@ -606,72 +615,234 @@ bool cmd_process_line(const char *line_in, Store *s, const char *db_path) {
     }
 
     if (strcmp(cmd, "query") == 0) {
-        if (!handle_query(args ? args : "", s)) {
+        if (!handle_query(ctx, args ? args : "", s)) {
             // Error printing handled in handler
         }
         return true;
     }
 
     if (strcmp(cmd, "find") == 0) {
-        if (!handle_find(args ? args : "", s)) {
+        if (!handle_find(ctx, args ? args : "", s)) {
             // Error printing handled in handler
         }
         return true;
     }
 
+    if (strcmp(cmd, "metrics") == 0) {
+        if (args) str_trim(args);
+        if (args && str_ieq(args, "reset")) {
+            metrics_reset();
+            fputs("Metrics reset.\n", ctx->out);
+        } else if (args && args[0] != '\0') {
+            fprintf(ctx->err, "METRICS takes no argument or RESET. Syntax: METRICS [RESET]\n");
+        } else {
+            metrics_report(ctx->out);
+        }
+        return true;
+    }
+
     if (strcmp(cmd, "help") == 0) {
-        if (!has_no_args(args, "HELP")) {
+        if (!has_no_args(ctx, args, "HELP")) {
             return true;
         }
 
-        puts("Available commands:");
-        puts("  OPEN                 - Load database from the configured file (unsaved changes will be lost).");
-        puts("  SAVE                 - Save current database to the configured file.");
-        puts("  SHOW [ALL] [SORT BY ID|MARK [ASC|DESC]]");
-        puts("                       - Display records. Optional sort clause (default: ID ASC).");
-        puts("  SHOW SUMMARY         - Display statistics: count, average, min/max (with names), grade bands.");
-        puts("  INSERT k=v ...       - Add a new student. Required keys: ID, Name, Programme, Mark.");
-        puts("                         Example: INSERT ID=1 Name=\"Jane Doe\" Programme=CS Mark=85.5");
-        puts("  UPDATE k=v ...       - Update an existing student. ID is required to identify the record.");
-        puts("                         Only provide keys you want to change (ID, Name, Programme, Mark).");
-        puts("  DELETE ID=...        - Delete a student by ID (prompts for confirmation).");
-        puts("                         Example: DELETE ID=1");
-        puts("  QUERY ID=...         - Show a single record by ID.");
-        puts("                         Example: QUERY ID=1");
-        puts("  FIND <Column> <Op> <Value>");
-        puts("                       - Search records. Columns: Name, Programme, Mark.");
-        puts("                         Operators for Name/Programme: =, CONTAINS (case-insensitive).");
-        puts("                         Operators for Mark: =, >, <, >=, <=.");
-        puts("                         Value for strings may be quoted, e.g. FIND Name CONTAINS \"Wang\".");
-        puts("                         Example: FIND Mark > 75");
-        puts("  HELP                 - Show this help text.");
-        puts("  EXIT | QUIT          - Exit the program (use SAVE to persist changes).");
-        puts("");
-        puts("Notes:");
-        puts("  - Keys are case-insensitive (ID, Name, Programme, Mark).");
-        puts("  - ID must be an integer; Mark is a floating point number.");
-        puts("  - For multi-word values enclose them in double quotes: Name=\"John Smith\".");
-        puts("  - When parsing key=value pairs, spaces separate tokens; quoted values may contain spaces.");
-        puts("  - Use OPEN to reload the DB file; this will discard unsaved in-memory changes.");
-        puts("  - Use SAVE to write current in-memory data to the DB file.");
-        puts("");
-        puts("Examples:");
-        puts("  INSERT ID=2 Name=\"Alice Lee\" Programme=IT Mark=72.0");
-        puts("  UPDATE ID=2 Mark=75.5");
-        puts("  SHOW ALL SORT BY MARK DESC");
-        puts("  FIND Name CONTAINS \"Wang\"");
-        puts("  FIND Mark >= 85");
+        fputs("Available commands:\n", ctx->out);
+        fputs("  OPEN                 - Load database from the configured file (unsaved changes will be lost).\n", ctx->out);
+        fputs("  SAVE                 - Save changes. After OPEN only the changes are appended to the journal.\n", ctx->out);
+        fputs("                         Does nothing when there are no unsaved changes.\n", ctx->out);
+        fputs("  COMPACT              - Rewrite the database file with all changes and empty the journal.\n", ctx->out);
+        fputs("                         Full rewrites run in the background and replace the file atomically.\n", ctx->out);
+        fputs("  CONVERT <src> <dst>  - Copy a database file between formats. A .cmsb destination is written as a\n", ctx->out);
+        fputs("                         binary snapshot, anything else as tab-separated text.\n", ctx->out);
+        fputs("  SHOW [ALL] [SORT BY ID|MARK [ASC|DESC]] [LIMIT n] [OFFSET m]\n", ctx->out);
+        fputs("                       - Display records. Optional sort clause (default: ID ASC).\n", ctx->out);
+        fputs("                         LIMIT/OFFSET page through large rosters.\n", ctx->out);
+        fputs("  SHOW SUMMARY         - Display statistics: count, average, min/max (with names), grade bands.\n", ctx->out);
+        fputs("  INSERT k=v ...       - Add a new student. Required keys: ID, Name, Programme, Mark.\n", ctx->out);
+        fputs("                         Example: INSERT ID=1 Name=\"Jane Doe\" Programme=CS Mark=85.5\n", ctx->out);
+        fputs("  IMPORT <file>        - Append a TSV file (CSV if named *.csv) and report rejected rows by reason.\n", ctx->out);
+        fputs("  UPDATE k=v ...       - Update an existing student. ID is required to identify the record.\n", ctx->out);
+        fputs("                         Only provide keys you want to change (ID, Name, Programme, Mark).\n", ctx->out);
+        fputs("  DELETE ID=...        - Delete a student by ID (prompts for confirmation).\n", ctx->out);
+        fputs("                         Example: DELETE ID=1\n", ctx->out);
+        fputs("  QUERY ID=...         - Show a single record by ID.\n", ctx->out);
+        fputs("                         Example: QUERY ID=1\n", ctx->out);
+        fputs("  FIND <Column> <Op> <Value> [AND|OR ...]\n", ctx->out);
+        fputs("                       - Search records. Columns: Name, Programme, Mark, ID.\n", ctx->out);
+        fputs("                         Operators for Name/Programme: =, CONTAINS (case-insensitive).\n", ctx->out);
+        fputs("                         Operators for Mark/ID: =, >, <, >=, <=.\n", ctx->out);
+        fputs("                         Combine comparisons with AND, OR, NOT and parentheses.\n", ctx->out);
+        fputs("                         Quote values that contain AND/OR, e.g. FIND Name CONTAINS \"Wang\".\n", ctx->out);
+        fputs("                         Example: FIND Programme = CS AND (Mark >= 85 OR ID < 2000000)\n", ctx->out);
+        fputs("  METRICS [RESET]      - Show per-command latency (count, p50, p99, max) and work counters,\n", ctx->out);
+        fputs("                         or start a new measuring period.\n", ctx->out);
+        fputs("  PROFILE <command>    - Run a command and report elapsed time, rows processed and CPU counters\n", ctx->out);
+        fputs("                         (cycles, instructions, cache/branch misses, page faults) where Linux allows.\n", ctx->out);
+        fputs("                         Example: PROFILE SHOW ALL SORT BY MARK\n", ctx->out);
+        fputs("  HELP                 - Show this help text.\n", ctx->out);
+        fputs("  EXIT | QUIT          - Exit the program (use SAVE to persist changes).\n", ctx->out);
+        fputc('\n', ctx->out);
+        fputs("Notes:\n", ctx->out);
+        fputs("  - Keys are case-insensitive (ID, Name, Programme, Mark).\n", ctx->out);
+        fputs("  - ID must be an integer; Mark is a floating point number.\n", ctx->out);
+        fputs("  - For multi-word values enclose them in double quotes: Name=\"John Smith\".\n", ctx->out);
+        fputs("  - An unquoted value runs up to the next key=; inside quotes, \\\" and \\\\ give a literal quote and backslash.\n", ctx->out);
+        fputs("  - Use OPEN to reload the DB file; this will discard unsaved in-memory changes.\n", ctx->out);
+        fputs("  - Use SAVE to write current in-memory data to the DB file.\n", ctx->out);
+        fputs("  - OPEN detects binary snapshots automatically; SAVE keeps the format of the existing file.\n", ctx->out);
+        fputs("  - OPEN replays saved changes from <db>.journal on top of the database file.\n", ctx->out);
+        fputc('\n', ctx->out);
+        fputs("Examples:\n", ctx->out);
+        fputs("  INSERT ID=2 Name=\"Alice Lee\" Programme=IT Mark=72.0\n", ctx->out);
+        fputs("  UPDATE ID=2 Mark=75.5\n", ctx->out);
+        fputs("  SHOW ALL SORT BY MARK DESC\n", ctx->out);
+        fputs("  SHOW ALL SORT BY ID LIMIT 50 OFFSET 100\n", ctx->out);
+        fputs("  FIND Name CONTAINS \"Wang\"\n", ctx->out);
+        fputs("  FIND Mark >= 85\n", ctx->out);
+        fputs("  FIND Programme CONTAINS \"Science\" AND NOT Mark < 50\n", ctx->out);
         return true;
         
     return true;
     }
-    if (strcmp(cmd, "exit") == 0 || strcmp(cmd, "quit") == 0) { return false; }
+    if (strcmp(cmd, "exit") == 0 || strcmp(cmd, "quit") == 0) {
+        view_cache_reset(&g_views);
+        return false;
+    }
 
 
-    printf("Unknown command: %s (type HELP)\n", cmd);
+    fprintf(ctx->out, "Unknown command: %s (type HELP)\n", cmd);
     return true;
 }
 
+static void print_profile(const CmdContext *ctx, const ProfileResult *r, size_t store_rows,
+                          const uint64_t work[METRIC_COUNTERS]) {
+    fprintf(ctx->out, "Profile: %.6f s elapsed, %zu record(s) in store\n", r->seconds, store_rows);
+    for (size_t c = 0; c < METRIC_COUNTERS; c++) {
+        if (work[c]) fprintf(ctx->out, "  %-16s %14llu\n", metrics_counter_name((MetricCounter)c), (unsigned long long)work[c]);
+    }
+
+    bool any = false;
+    for (size_t e = 0; e < PROFILE_EVENTS; e++) any |= r->valid[e];
+    if (!any) {
+        fprintf(ctx->out, "  Hardware counters unavailable (%s); timing only.\n",
+                r->open_errno ? strerror(r->open_errno) : "no events counted");
+        return;
+    }
+
+    if (r->open_errno) {
+        fprintf(ctx->out, "  (events marked n/a are unavailable: %s)\n", strerror(r->open_errno));
+    }
+
+    // Per-row figures use the rows FIND tested or the sort ordered, else the whole store
+    uint64_t worked = work[METRIC_ROWS_SCANNED] ? work[METRIC_ROWS_SCANNED] : work[METRIC_ROWS_SORTED];
+    double rows = (double)(worked ? worked : store_rows);
+    for (size_t e = 0; e < PROFILE_EVENTS; e++) {
+        const char *name = profile_event_name((ProfileEvent)e);
+        if (!r->valid[e]) {
+            fprintf(ctx->out, "  %-16s %14s\n", name, "n/a");
+            continue;
+        }
+        fprintf(ctx->out, "  %-16s %14llu", name, (unsigned long long)r->value[e]);
+        if (e == PROFILE_INSTRUCTIONS && r->valid[PROFILE_CYCLES] && r->value[PROFILE_CYCLES]) {
+            fprintf(ctx->out, "   %.2f per cycle", (double)r->value[e] / (double)r->value[PROFILE_CYCLES]);
+        } else if (rows > 0) {
+            fprintf(ctx->out, "   %.2f per row", (double)r->value[e] / rows);
+        }
+        fputs(r->scaled[e] ? " (scaled)\n" : "\n", ctx->out);
+    }
+}
+
+// PROFILE <command...>: run the command with event counters around it. The
+// counters and work totals are process-wide, so in server mode they include
+// whatever other clients ran meanwhile.
+static bool run_profiled(const CmdContext *ctx, char *args, Store *s, const char *db_path) {
+    if (args) str_trim(args);
+    if (!args || args[0] == '\0') {
+        fprintf(ctx->err, "PROFILE requires a command. Syntax: PROFILE <command...>\n");
+        return true;
+    }
+    if (strncasecmp(args, "profile", 7) == 0 && (args[7] == '\0' || isspace((unsigned char)args[7]))) {
+        fprintf(ctx->err, "PROFILE cannot profile itself.\n");
+        return true;
+    }
+
+    uint64_t work[METRIC_COUNTERS];
+    for (size_t c = 0; c < METRIC_COUNTERS; c++) {
+        work[c] = atomic_load_explicit(&metrics_counters[c], memory_order_relaxed);
+    }
+    ProfileSession ps;
+    profile_begin(&ps);
+    bool more = cmd_execute(ctx, args, s, db_path);
+    ProfileResult r;
+    profile_end(&ps, &r);
+    for (size_t c = 0; c < METRIC_COUNTERS; c++) {
+        work[c] = atomic_load_explicit(&metrics_counters[c], memory_order_relaxed) - work[c];
+    }
+
+    lock_shared(ctx);
+    size_t rows = s->size;
+    unlock_store(ctx);
+    print_profile(ctx, &r, rows, work);
+    return more;
+}
+
+bool cmd_execute(const CmdContext *ctx, const char *line_in, Store *s, const char *db_path) {
+    // Make a modifiable copy of the input line
+    char line[512];
+    strncpy(line, line_in, sizeof(line));
+    line[sizeof(line) - 1] = '\0';
+
+    //split commands and arguments
+    char *p = line;
+    while (*p && !isspace((unsigned char)*p)) p++;
+    char *cmd = line;
+    char *args = NULL;
+    if (*p) {
+        *p = '\0';
+        args = p + 1;
+    }
+    str_tolower(cmd);
+
+    if (strcmp(cmd, "profile") == 0) {
+        return run_profiled(ctx, args, s, db_path);
+    }
+
+    // Latency includes waiting for the store lock, as the caller sees it
+    uint64_t t0 = metrics_now_ns();
+    bool more;
+    // SHOW and FIND lock for themselves so long listings can use a version;
+    // METRICS does not read the store
+    if (!ctx->shared || strcmp(cmd, "show") == 0 || strcmp(cmd, "find") == 0 ||
+        strcmp(cmd, "metrics") == 0) {
+        more = run_command(ctx, cmd, args, s, db_path);
+    } else {
+        if (strcmp(cmd, "query") == 0 || strcmp(cmd, "help") == 0) {
+            lock_shared(ctx);
+        } else {
+            lock_exclusive(ctx);
+            // Hand a finished background save's failure to this client
+            if (!saver_busy()) collect_save(ctx, s, db_path);
+        }
+        more = run_command(ctx, cmd, args, s, db_path);
+        unlock_store(ctx);
+    }
+    metrics_record(cmd, metrics_now_ns() - t0);
+    return more;
+}
+
+bool cmd_wait_saved(Store *s) {
+    if (saver_busy()) {
+        puts("Waiting for the background save to finish...");
+    }
+    collect_save(NULL, s, NULL);
+    return store_is_dirty(s);
+}
+
+bool cmd_process_line(const char *line, Store *s, const char *db_path) {
+    CmdContext ctx = { .out = stdout, .err = stderr, .batch = g_batch };
+    return cmd_execute(&ctx, line, s, db_path);
+}
+
 void print_declaration(const char *team_name, const char *members_csv, const char *date_str) {
     puts("============================================");
     puts("We declare that this is our own work and ...");
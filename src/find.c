@@ -0,0 +1,783 @@
+#include <ctype.h>
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "find.h"
+#include "markscan.h"
+#include "metrics.h"
+#include "pool.h"
+#include "util.h"
+
+#define FIND_PART_MIN 8192          // Rows per part before another thread joins in
+#define FIND_ROUND_ROWS (1u << 18)  // Rows per pool round; bounds buffered output
+
+// One part's formatted matches for the current round
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t cap;
+    size_t count;
+    bool oom;
+} MatchBuf;
+
+typedef struct {
+    const Store *s;
+    const Store *views;   // Per-chunk views of a version; row i is views[i / STORE_BLOCK_ROWS]
+    const int *slots;
+    size_t base;    // First row of the current round
+    FindPred pred;
+    const void *arg;
+    MatchBuf parts[POOL_MAX_PARTS];
+} FindScan;
+
+static void append_row(MatchBuf *mb, const Store *s, size_t slot) {
+    for (;;) {
+        size_t room = mb->cap - mb->len;
+        int n = snprintf(mb->buf + mb->len, room, "%d\t%s\t%s\t%.2f\n",
+                         s->ids[slot], store_name(s, slot), prog_name(s->progs[slot]), s->marks[slot]);
+        if (n < 0) {
+            mb->oom = true;
+            return;
+        }
+        if ((size_t)n < room) {
+            mb->len += (size_t)n;
+            mb->count++;
+            return;
+        }
+        size_t new_cap = mb->cap ? mb->cap * 2 : 16 * 1024;
+        while (new_cap - mb->len <= (size_t)n) new_cap *= 2;
+        char *grown = realloc(mb->buf, new_cap);
+        if (!grown) {
+            mb->oom = true;
+            return;
+        }
+        mb->buf = grown;
+        mb->cap = new_cap;
+    }
+}
+
+static void scan_part(void *ctx, size_t part, size_t begin, size_t end) {
+    FindScan *fs = ctx;
+    MatchBuf *mb = &fs->parts[part];
+    mb->len = 0;
+    mb->count = 0;
+    for (size_t i = fs->base + begin; i < fs->base + end && !mb->oom; i++) {
+        const Store *s = fs->s;
+        size_t slot = fs->slots ? (size_t)fs->slots[i] : i;
+        if (fs->views) {
+            s = &fs->views[i / STORE_BLOCK_ROWS];
+            slot = i % STORE_BLOCK_ROWS;
+        }
+        if (!fs->pred || fs->pred(s, slot, fs->arg)) {
+            append_row(mb, s, slot);
+        }
+    }
+}
+
+static bool print_scan(FILE *out, FILE *err, FindScan *fs, size_t n) {
+    size_t total = 0;
+    bool ok = true;
+
+    for (fs->base = 0; fs->base < n && ok; fs->base += FIND_ROUND_ROWS) {
+        size_t rows = n - fs->base < FIND_ROUND_ROWS ? n - fs->base : FIND_ROUND_ROWS;
+        size_t parts = pool_run(rows, FIND_PART_MIN, scan_part, fs);
+        for (size_t p = 0; p < parts; p++) {
+            MatchBuf *mb = &fs->parts[p];
+            if (mb->oom) {
+                ok = false;
+                break;
+            }
+            if (mb->count > 0 && total == 0) {
+                fputs("ID\tName\tProgramme\tMark\n", out);
+            }
+            fwrite(mb->buf, 1, mb->len, out);
+            total += mb->count;
+        }
+    }
+    for (size_t p = 0; p < POOL_MAX_PARTS; p++) {
+        free(fs->parts[p].buf);
+    }
+    metrics_add(METRIC_ROWS_SCANNED, n);
+    metrics_add(METRIC_ROWS_MATCHED, total);
+
+    if (!ok) {
+        fprintf(err, "Error: Out of memory while collecting matches.\n");
+        return false;
+    }
+    if (total == 0) {
+        fputs("No matching records found.\n", out);
+    } else {
+        fprintf(out, "Total matches: %zu\n", total);
+    }
+    return true;
+}
+
+bool find_print(FILE *out, FILE *err, const Store *s, const int *slots, size_t n, FindPred pred, const void *arg) {
+    FindScan fs = { .s = s, .slots = slots, .pred = pred, .arg = arg };
+    return print_scan(out, err, &fs, n);
+}
+
+// ---- Expression compiler ----
+
+typedef enum {
+    NODE_AND,
+    NODE_OR,
+    NODE_NOT,
+    NODE_NAME,
+    NODE_PROG,
+    NODE_MARK,
+    NODE_ID
+} NodeKind;
+
+typedef struct FindNode FindNode;
+typedef bool (*NodeEval)(const FindNode *n, const Store *s, size_t slot);
+
+// Each node carries the evaluator for its exact column and operator, so rows
+// never go back through the column and operator strings
+struct FindNode {
+    NodeKind kind;
+    NodeEval eval;
+    FindNode **kids;        // AND, OR, NOT
+    size_t n_kids;
+    char *text;             // Name or Programme value
+    bool exact;             // Programme: equality rather than CONTAINS
+    bool *wanted;           // Programme: codes whose name matches
+    size_t n_codes;
+    MarkRange range;        // Mark range as written, for planning
+    float lo, hi;           // Mark range, inclusive
+    long long id_lo, id_hi; // ID range, inclusive
+};
+
+struct FindQuery {
+    FindNode *root;
+};
+
+static bool eval_and(const FindNode *n, const Store *s, size_t slot) {
+    for (size_t i = 0; i < n->n_kids; i++) {
+        if (!n->kids[i]->eval(n->kids[i], s, slot)) return false;
+    }
+    return true;
+}
+
+static bool eval_or(const FindNode *n, const Store *s, size_t slot) {
+    for (size_t i = 0; i < n->n_kids; i++) {
+        if (n->kids[i]->eval(n->kids[i], s, slot)) return true;
+    }
+    return false;
+}
+
+static bool eval_not(const FindNode *n, const Store *s, size_t slot) {
+    return !n->kids[0]->eval(n->kids[0], s, slot);
+}
+
+static bool eval_name_eq(const FindNode *n, const Store *s, size_t slot) {
+    return str_ieq(store_name(s, slot), n->text);
+}
+
+static bool eval_name_contains(const FindNode *n, const Store *s, size_t slot) {
+    return str_icase_find(store_name(s, slot), n->text) != NULL;
+}
+
+static bool eval_prog(const FindNode *n, const Store *s, size_t slot) {
+    ProgCode code = s->progs[slot];
+    return code <= n->n_codes && n->wanted[code];
+}
+
+static bool eval_mark(const FindNode *n, const Store *s, size_t slot) {
+    float m = s->marks[slot];
+    return m >= n->lo && m <= n->hi;
+}
+
+static bool eval_id(const FindNode *n, const Store *s, size_t slot) {
+    long long id = s->ids[slot];
+    return id >= n->id_lo && id <= n->id_hi;
+}
+
+typedef struct {
+    const char *p;
+    FILE *err;      // Where compile errors go
+} Parser;
+
+static FindNode *node_new(Parser *ps, NodeKind kind, NodeEval eval) {
+    FindNode *n = calloc(1, sizeof *n);
+    if (!n) {
+        fprintf(ps->err, "Error: Out of memory while compiling FIND expression.\n");
+        return NULL;
+    }
+    n->kind = kind;
+    n->eval = eval;
+    return n;
+}
+
+static void node_free(FindNode *n) {
+    if (!n) return;
+    for (size_t i = 0; i < n->n_kids; i++) {
+        node_free(n->kids[i]);
+    }
+    free(n->kids);
+    free(n->text);
+    free(n->wanted);
+    free(n);
+}
+
+static bool node_add(Parser *ps, FindNode *n, FindNode *kid) {
+    FindNode **grown = realloc(n->kids, (n->n_kids + 1) * sizeof *grown);
+    if (!grown) {
+        fprintf(ps->err, "Error: Out of memory while compiling FIND expression.\n");
+        node_free(kid);
+        return false;
+    }
+    n->kids = grown;
+    n->kids[n->n_kids++] = kid;
+    return true;
+}
+
+static void skip_space(Parser *ps) {
+    while (isspace((unsigned char)*ps->p)) ps->p++;
+}
+
+// Case-insensitive keyword at p that ends on a word boundary
+static bool at_keyword(const char *p, const char *kw) {
+    size_t len = strlen(kw);
+    return strncasecmp(p, kw, len) == 0 && !isalnum((unsigned char)p[len]) && p[len] != '_';
+}
+
+static bool take_keyword(Parser *ps, const char *kw) {
+    skip_space(ps);
+    if (!at_keyword(ps->p, kw)) return false;
+    ps->p += strlen(kw);
+    return true;
+}
+
+static const char *near_text(const char *p) {
+    return *p ? p : "end of input";
+}
+
+// Column names and word operators
+static size_t take_word(Parser *ps, char *dst, size_t cap) {
+    skip_space(ps);
+    size_t len = 0;
+    while (isalnum((unsigned char)*ps->p) || *ps->p == '_') {
+        if (len + 1 < cap) dst[len++] = *ps->p;
+        ps->p++;
+    }
+    dst[len] = '\0';
+    return len;
+}
+
+static size_t take_op(Parser *ps, char *dst, size_t cap) {
+    skip_space(ps);
+    if (*ps->p == '\0' || !strchr("<>=", *ps->p)) {
+        return take_word(ps, dst, cap);
+    }
+    size_t len = 0;
+    while (*ps->p && strchr("<>=", *ps->p) && len + 1 < cap) {
+        dst[len++] = *ps->p++;
+    }
+    dst[len] = '\0';
+    return len;
+}
+
+// A quoted string, or bare text up to AND/OR, an unmatched ')' or the end.
+// Bare values keep their inner spaces, so FIND Name = Jane Doe still works.
+static char *take_value(Parser *ps) {
+    skip_space(ps);
+    const char *start = ps->p, *end = ps->p;
+    if (*ps->p == '"') {
+        start = ps->p + 1;
+        end = strchr(start, '"');
+        if (!end) {
+            fprintf(ps->err, "Error: Unterminated quote in FIND value: %s\n", ps->p);
+            return NULL;
+        }
+        ps->p = end + 1;
+    } else {
+        int depth = 0;
+        while (*ps->p) {
+            if (isspace((unsigned char)*ps->p)) {
+                const char *next = ps->p;
+                while (isspace((unsigned char)*next)) next++;
+                if (at_keyword(next, "and") || at_keyword(next, "or")) break;
+                ps->p = next;
+                continue;
+            }
+            if (*ps->p == '(') {
+                depth++;
+            } else if (*ps->p == ')') {
+                if (depth == 0) break;
+                depth--;
+            }
+            end = ++ps->p;
+        }
+        if (end == start) {
+            fprintf(ps->err, "Error: Missing value in FIND expression near: %s\n", near_text(ps->p));
+            return NULL;
+        }
+    }
+
+    size_t len = (size_t)(end - start);
+    char *value = malloc(len + 1);
+    if (!value) {
+        fprintf(ps->err, "Error: Out of memory while compiling FIND expression.\n");
+        return NULL;
+    }
+    memcpy(value, start, len);
+    value[len] = '\0';
+    return value;
+}
+
+static bool text_op(Parser *ps, const char *column, const char *op, bool *exact) {
+    if (strcmp(op, "=") == 0) {
+        *exact = true;
+    } else if (strcasecmp(op, "contains") == 0) {
+        *exact = false;
+    } else {
+        fprintf(ps->err, "Error: Unsupported operator for %s column: %s\n", column, op);
+        return false;
+    }
+    return true;
+}
+
+static bool mark_range_for(const char *op, float v, MarkRange *r) {
+    r->lo = -INFINITY;
+    r->hi = INFINITY;
+    r->lo_incl = r->hi_incl = true;
+    if (strcmp(op, "=") == 0) {
+        r->lo = v - 0.01f;
+        r->hi = v + 0.01f;
+    } else if (strcmp(op, ">") == 0) {
+        r->lo = v;
+        r->lo_incl = false;
+    } else if (strcmp(op, "<") == 0) {
+        r->hi = v;
+        r->hi_incl = false;
+    } else if (strcmp(op, ">=") == 0) {
+        r->lo = v;
+    } else if (strcmp(op, "<=") == 0) {
+        r->hi = v;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool id_range_for(const char *op, long long v, long long *lo, long long *hi) {
+    *lo = INT_MIN;
+    *hi = INT_MAX;
+    if (strcmp(op, "=") == 0) {
+        *lo = *hi = v;
+    } else if (strcmp(op, ">") == 0) {
+        *lo = v + 1;
+    } else if (strcmp(op, "<") == 0) {
+        *hi = v - 1;
+    } else if (strcmp(op, ">=") == 0) {
+        *lo = v;
+    } else if (strcmp(op, "<=") == 0) {
+        *hi = v;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Lower one comparison to a leaf with its evaluator bound
+static FindNode *make_leaf(Parser *ps, const char *column, const char *op, char *value) {
+    FindNode *n = NULL;
+    bool exact;
+
+    if (strcasecmp(column, "name") == 0) {
+        if (!text_op(ps, "Name", op, &exact)) goto fail;
+        n = node_new(ps, NODE_NAME, exact ? eval_name_eq : eval_name_contains);
+        if (!n) goto fail;
+        n->text = value;
+        return n;
+    }
+
+    if (strcasecmp(column, "programme") == 0) {
+        if (!text_op(ps, "Programme", op, &exact)) goto fail;
+        n = node_new(ps, NODE_PROG, eval_prog);
+        if (!n) goto fail;
+        // The code mask is built by bind_codes when the query runs
+        n->text = value;
+        n->exact = exact;
+        return n;
+    }
+
+    if (strcasecmp(column, "mark") == 0) {
+        float v;
+        MarkRange r;
+        if (!parse_float(value, &v)) {
+            fprintf(ps->err, "Error: Invalid mark value for FIND command: %s\n", value);
+            goto fail;
+        }
+        if (!mark_range_for(op, v, &r)) {
+            fprintf(ps->err, "Error: Unsupported operator for Mark column: %s\n", op);
+            goto fail;
+        }
+        n = node_new(ps, NODE_MARK, eval_mark);
+        if (!n) goto fail;
+        n->range = r;
+        markscan_bounds(r, &n->lo, &n->hi);
+        free(value);
+        return n;
+    }
+
+    if (strcasecmp(column, "id") == 0) {
+        int v;
+        long long lo, hi;
+        if (!parse_int(value, &v)) {
+            fprintf(ps->err, "Error: Invalid ID value for FIND command: %s\n", value);
+            goto fail;
+        }
+        if (!id_range_for(op, v, &lo, &hi)) {
+            fprintf(ps->err, "Error: Unsupported operator for ID column: %s\n", op);
+            goto fail;
+        }
+        n = node_new(ps, NODE_ID, eval_id);
+        if (!n) goto fail;
+        n->id_lo = lo;
+        n->id_hi = hi;
+        free(value);
+        return n;
+    }
+
+    fprintf(ps->err, "Error: Unsupported column for FIND command: %s\nUse Name, Programme, Mark, ID.\n", column);
+fail:
+    free(value);
+    node_free(n);
+    return NULL;
+}
+
+static FindNode *parse_or(Parser *ps);
+
+static FindNode *parse_compare(Parser *ps) {
+    char column[32], op[16];
+    skip_space(ps);
+    const char *at = ps->p;
+    if (take_word(ps, column, sizeof column) == 0 || take_op(ps, op, sizeof op) == 0) {
+        fprintf(ps->err, "Error: Expected <Column> <Operator> <Value> in FIND expression near: %s\n", near_text(at));
+        return NULL;
+    }
+    char *value = take_value(ps);
+    return value ? make_leaf(ps, column, op, value) : NULL;
+}
+
+static FindNode *parse_unary(Parser *ps) {
+    if (take_keyword(ps, "not")) {
+        FindNode *kid = parse_unary(ps);
+        if (!kid) return NULL;
+        FindNode *n = node_new(ps, NODE_NOT, eval_not);
+        if (!n) {
+            node_free(kid);
+            return NULL;
+        }
+        if (!node_add(ps, n, kid)) {
+            node_free(n);
+            return NULL;
+        }
+        return n;
+    }
+
+    skip_space(ps);
+    if (*ps->p == '(') {
+        ps->p++;
+        FindNode *n = parse_or(ps);
+        if (!n) return NULL;
+        skip_space(ps);
+        if (*ps->p != ')') {
+            fprintf(ps->err, "Error: Missing ')' in FIND expression near: %s\n", near_text(ps->p));
+            node_free(n);
+            return NULL;
+        }
+        ps->p++;
+        return n;
+    }
+    return parse_compare(ps);
+}
+
+static FindNode *parse_and(Parser *ps);
+
+// left (kw operand)*, flattened into one node with a child per operand
+static FindNode *parse_chain(Parser *ps, NodeKind kind, NodeEval eval, const char *kw,
+                             FindNode *(*operand)(Parser *)) {
+    FindNode *first = operand(ps);
+    if (!first) return NULL;
+    Parser look = *ps;
+    if (!take_keyword(&look, kw)) return first;
+
+    FindNode *n = node_new(ps, kind, eval);
+    if (!n) {
+        node_free(first);
+        return NULL;
+    }
+    if (!node_add(ps, n, first)) {
+        node_free(n);
+        return NULL;
+    }
+    while (take_keyword(ps, kw)) {
+        FindNode *kid = operand(ps);
+        if (!kid || !node_add(ps, n, kid)) {
+            node_free(n);
+            return NULL;
+        }
+    }
+    return n;
+}
+
+static FindNode *parse_and(Parser *ps) {
+    return parse_chain(ps, NODE_AND, eval_and, "and", parse_unary);
+}
+
+static FindNode *parse_or(Parser *ps) {
+    return parse_chain(ps, NODE_OR, eval_or, "or", parse_and);
+}
+
+FindQuery *find_compile(const char *expr, FILE *err) {
+    Parser ps = { .p = expr, .err = err };
+    FindNode *root = parse_or(&ps);
+    if (!root) return NULL;
+    skip_space(&ps);
+    if (*ps.p) {
+        fprintf(ps.err, "Error: Unexpected text in FIND expression: %s\n", ps.p);
+        node_free(root);
+        return NULL;
+    }
+
+    FindQuery *q = malloc(sizeof *q);
+    if (!q) {
+        fprintf(ps.err, "Error: Out of memory while compiling FIND expression.\n");
+        node_free(root);
+        return NULL;
+    }
+    q->root = root;
+    return q;
+}
+
+void find_free(FindQuery *q) {
+    if (!q) return;
+    node_free(q->root);
+    free(q);
+}
+
+// Test each programme dictionary entry once, so rows only look up their code.
+// Runs with the store locked or a version pinned: every code a row there can
+// hold is already interned. Codes added since the last run are tested then.
+static bool bind_codes(FindNode *n, FILE *err) {
+    for (size_t i = 0; i < n->n_kids; i++) {
+        if (!bind_codes(n->kids[i], err)) return false;
+    }
+    if (n->kind != NODE_PROG) return true;
+    size_t count = prog_count();
+    if (n->wanted && count == n->n_codes) return true;
+    bool *grown = realloc(n->wanted, (count + 1) * sizeof *grown);
+    if (!grown) {
+        fprintf(err, "Error: Out of memory while collecting matches.\n");
+        return false;
+    }
+    n->wanted = grown;
+    n->wanted[0] = false;
+    for (size_t code = n->n_codes + 1; code <= count; code++) {
+        const char *name = prog_name((ProgCode)code);
+        n->wanted[code] = n->exact ? str_ieq(name, n->text) : str_icase_find(name, n->text) != NULL;
+    }
+    n->n_codes = count;
+    return true;
+}
+
+// ---- Planning ----
+
+// Walk the mark index instead of scanning once fewer than 1/MARK_SCAN_RATIO
+// of the rows are expected to match
+#define MARK_SCAN_RATIO 32
+
+// Expected match count for r, spreading each grade band's tally evenly over
+// its share of [0, 100]
+static double mark_range_estimate(const Store *s, MarkRange r) {
+    static const float band_lo[GRADE_BANDS] = { GRADE_A_MIN, GRADE_B_MIN, GRADE_C_MIN, GRADE_D_MIN, 0.0f };
+    static const float band_hi[GRADE_BANDS] = { 100.0f, GRADE_A_MIN, GRADE_B_MIN, GRADE_C_MIN, GRADE_D_MIN };
+    double est = 0.0;
+    for (int b = 0; b < GRADE_BANDS; b++) {
+        float lo = r.lo > band_lo[b] ? r.lo : band_lo[b];
+        float hi = r.hi < band_hi[b] ? r.hi : band_hi[b];
+        if (hi < lo) continue;
+        double share = (hi - lo + 0.1) / (band_hi[b] - band_lo[b]);
+        est += (double)s->agg.band[b] * (share < 1.0 ? share : 1.0);
+    }
+    return est;
+}
+
+// Slots gathered from an index lookup, sorted back into store order
+typedef struct {
+    const Store *s;
+    int *slots;
+    size_t count;
+    size_t cap;
+    bool oom;
+} SlotList;
+
+static void collect_slot(int id, void *ctx) {
+    SlotList *l = ctx;
+    if (l->count == l->cap) {
+        size_t new_cap = l->cap ? l->cap * 2 : 64;
+        int *grown = realloc(l->slots, new_cap * sizeof *grown);
+        if (!grown) {
+            l->oom = true;
+            return;
+        }
+        l->slots = grown;
+        l->cap = new_cap;
+    }
+    l->slots[l->count++] = store_find_index_by_id(l->s, id);
+}
+
+static int cmp_int_asc(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+// The AND-ed comparisons an index can serve
+typedef struct {
+    const FindNode *id_eq;      // ID equality
+    const FindNode *narrow;     // Most selective mark range under the scan ratio
+    const FindNode *wide;       // Any other mark range
+    const FindNode *grams;      // Name long enough for the trigram index
+    bool grams_narrow;          // and its candidates are under the scan ratio
+} PlanTerms;
+
+static void pick_terms(const FindNode *root, Store *s, PlanTerms *pt) {
+    const FindNode *const *terms = &root;
+    size_t n_terms = 1;
+    if (root->kind == NODE_AND) {
+        terms = (const FindNode *const *)root->kids;
+        n_terms = root->n_kids;
+    }
+
+    *pt = (PlanTerms){ 0 };
+    double narrow_est = 0.0;
+    for (size_t i = 0; i < n_terms; i++) {
+        const FindNode *t = terms[i];
+        if (t->kind == NODE_ID && t->id_lo == t->id_hi) {
+            pt->id_eq = t;
+        } else if (t->kind == NODE_MARK) {
+            double est = mark_range_estimate(s, t->range);
+            if (est * MARK_SCAN_RATIO > (double)s->size) {
+                pt->wide = t;
+            } else if (!pt->narrow || est < narrow_est) {
+                pt->narrow = t;
+                narrow_est = est;
+            }
+        } else if (t->kind == NODE_NAME && !pt->grams && strlen(t->text) >= TRIGRAM_MIN_NEEDLE) {
+            pt->grams = t;
+            double est = (double)trigram_estimate(&s->name_grams, t->text);
+            pt->grams_narrow = est * MARK_SCAN_RATIO <= (double)s->size;
+        }
+    }
+}
+
+// Candidate slots, in store order, from the cheapest AND-ed comparison: an ID
+// lookup, a selective mark range on the index, a name on the trigram index,
+// then a wide mark range on the vector scan. Returns 1 with candidates, 0 if
+// every row must be tested, -1 if memory ran out.
+static int plan_candidates(const FindNode *root, Store *s, int **out, size_t *count) {
+    PlanTerms pt;
+    pick_terms(root, s, &pt);
+
+    if (pt.id_eq) {
+        *out = malloc(sizeof **out);
+        if (!*out) return -1;
+        int slot = store_find_index_by_id(s, (int)pt.id_eq->id_lo);
+        (*out)[0] = slot;
+        *count = slot >= 0;
+        return 1;
+    }
+
+    if (pt.narrow) {
+        SlotList list = { .s = s };
+        markindex_range(&s->mark_index, pt.narrow->range, collect_slot, &list);
+        if (list.oom) {
+            free(list.slots);
+            return -1;
+        }
+        qsort(list.slots, list.count, sizeof *list.slots, cmp_int_asc);
+        *out = list.slots;
+        *count = list.count;
+        return 1;
+    }
+
+    int *ids = NULL;
+    size_t n_ids = 0;
+    if (pt.grams && trigram_candidates(&s->name_grams, pt.grams->text, &ids, &n_ids)) {
+        for (size_t i = 0; i < n_ids; i++) {
+            ids[i] = store_find_index_by_id(s, ids[i]);
+        }
+        qsort(ids, n_ids, sizeof *ids, cmp_int_asc);
+        *out = ids;
+        *count = n_ids;
+        return 1;
+    }
+
+    if (pt.wide) {
+        *out = malloc((s->size ? s->size : 1) * sizeof **out);
+        if (!*out) return -1;
+        *count = markscan_filter(s->marks, s->size, pt.wide->range, *out);
+        return 1;
+    }
+    return 0;
+}
+
+static bool query_pred(const Store *s, size_t slot, const void *arg) {
+    const FindNode *root = arg;
+    return root->eval(root, s, slot);
+}
+
+bool find_run(FILE *out, FILE *err, const FindQuery *q, Store *s) {
+    if (!bind_codes(q->root, err)) {
+        return false;
+    }
+    int *slots = NULL;
+    size_t count = 0;
+    int plan = plan_candidates(q->root, s, &slots, &count);
+    if (plan < 0) {
+        fprintf(err, "Error: Out of memory while collecting matches.\n");
+        return false;
+    }
+
+    bool ok = plan ? find_print(out, err, s, slots, count, query_pred, q->root)
+                   : find_print(out, err, s, NULL, s->size, query_pred, q->root);
+    free(slots);
+    return ok;
+}
+
+bool find_is_point(const FindQuery *q, Store *s) {
+    PlanTerms pt;
+    pick_terms(q->root, s, &pt);
+    return pt.id_eq || pt.narrow || pt.grams_narrow;
+}
+
+bool find_run_version(FILE *out, FILE *err, const FindQuery *q, const StoreVersion *v) {
+    if (!bind_codes(q->root, err)) {
+        return false;
+    }
+    // Store-shaped views of each chunk, so the evaluators and row formatting
+    // read a version the same way they read the store
+    Store *views = calloc(v->n_chunks ? v->n_chunks : 1, sizeof *views);
+    if (!views) {
+        fprintf(err, "Error: Out of memory while collecting matches.\n");
+        return false;
+    }
+    for (size_t b = 0; b < v->n_chunks; b++) {
+        VersionChunk *c = v->chunks[b];
+        views[b].ids = c->ids;
+        views[b].marks = c->marks;
+        views[b].name_off = c->name_off;
+        views[b].name_arena = c->names;
+        views[b].progs = c->progs;
+        views[b].size = v->size - b * STORE_BLOCK_ROWS < STORE_BLOCK_ROWS ? v->size - b * STORE_BLOCK_ROWS : STORE_BLOCK_ROWS;
+    }
+    FindScan fs = { .views = views, .pred = query_pred, .arg = q->root };
+    bool ok = print_scan(out, err, &fs, v->size);
+    free(views);
+    return ok;
+}
@@ -1,88 +1,585 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "util.h"
 #include "io.h"
+#include "metrics.h"
+#include "snapshot.h"
 #include "store.h"
 #include "student.h"
 
-// Helper: strip trailing newline and optional carriage return
-static void strip_eol(char *line) {
-    char *nl = strchr(line, '\n');
-    if (nl) *nl = '\0';
-    size_t len = strlen(line);
-    if (len && line[len - 1] == '\r') {
-        line[len - 1] = '\0';
+#define MIN_CHUNK_BYTES (1u << 20) // Files smaller than this are parsed on one thread
+#define MAX_LOAD_THREADS 32
+
+typedef enum {
+    LINE_BLANK,     // Empty line or comment, not counted
+    LINE_OK,
+    LINE_MALFORMED  // Counted as skipped
+} LineResult;
+
+typedef enum {
+    ROWS_TSV,       // Tab runs separate fields, as the database file
+    ROWS_CSV        // Commas separate fields, which may be "quoted" with "" escapes
+} RowFormat;
+
+#define PROG_CACHE_SIZE 64 // Per-chunk cache in front of the shared programme dictionary
+#define FIELD_MAX 64       // Longest cell text kept, including the terminator
+
+typedef struct {
+    char text[64];
+    size_t len;
+    ProgCode code;
+} ProgCacheEntry;
+
+// Rows parsed from one newline-aligned slice of the file
+typedef struct {
+    const char *begin;
+    const char *end;
+    RowFormat format;
+    bool check;           // IMPORT: validate rows here and tally rejections by reason
+    bool first;           // Holds the start of the file, where a header may be
+    Student *rows;
+    unsigned *row_lines;  // Chunk-relative line of each row, when checking
+    size_t count;
+    size_t cap;
+    size_t lines;
+    int skipped;
+    ImportReport report;  // Rejections seen in this chunk, lines chunk-relative
+    ProgCacheEntry prog_cache[PROG_CACHE_SIZE];
+} LoadChunk;
+
+// Next tab-delimited token, skipping runs of tabs like strtok(..., "\t") does
+static bool next_field(const char **p, const char *end, const char **tok, const char **tok_end) {
+    const char *q = *p;
+    while (q < end && *q == '\t') q++;
+    if (q == end) return false;
+    *tok = q;
+    while (q < end && *q != '\t') q++;
+    *tok_end = q;
+    *p = q;
+    return true;
+}
+
+// Next comma-delimited field. Quoted fields are unescaped into scratch, which
+// holds FIELD_MAX bytes; longer text is cut there and still reads as too long.
+// *p becomes NULL after the last field of the line.
+static bool next_csv_field(const char **p, const char *end, char *scratch,
+                           const char **tok, const char **tok_end) {
+    const char *q = *p;
+    if (!q) return false;
+    while (q < end && (*q == ' ' || *q == '\t')) q++;
+    if (q < end && *q == '"') {
+        size_t len = 0;
+        for (q++; q < end; q++) {
+            if (*q == '"') {
+                if (q + 1 < end && q[1] == '"') q++;
+                else break;
+            }
+            if (len < FIELD_MAX) scratch[len++] = *q;
+        }
+        if (q == end) return false;  // Unterminated quote
+        q++;
+        while (q < end && (*q == ' ' || *q == '\t')) q++;
+        if (q < end && *q != ',') return false;
+        *tok = scratch;
+        *tok_end = scratch + len;
+    } else {
+        *tok = q;
+        while (q < end && *q != ',') q++;
+        *tok_end = q;
     }
+    *p = q < end ? q + 1 : NULL;
+    return true;
 }
 
-// Expect tab-separated values: id, name, programme, mark
-bool cms_load(const char *path, Store *s, int *skipped_lines) {
-    FILE *fp = fopen(path, "r");
-    if (!fp) {
-        return false; // File missing is not fatal, caller proceeds with empty store
+static void trim_range(const char **b, const char **e) {
+    while (*b < *e && isspace((unsigned char)**b)) (*b)++;
+    while (*e > *b && isspace((unsigned char)(*e)[-1])) (*e)--;
+}
+
+static void copy_field(char *dst, size_t dst_size, const char *b, const char *e) {
+    size_t len = (size_t)(e - b);
+    if (len > dst_size - 1) len = dst_size - 1;
+    memcpy(dst, b, len);
+    dst[len] = '\0';
+}
+
+// Programmes repeat across rows, so most lookups stay in the chunk's own cache
+static ProgCode chunk_intern(LoadChunk *c, const char *b, const char *e) {
+    size_t len = (size_t)(e - b);
+    if (len > 63) len = 63;
+    size_t h = len;
+    for (size_t i = 0; i < len; i++) h = h * 31 + (unsigned char)b[i];
+    ProgCacheEntry *slot = &c->prog_cache[h % PROG_CACHE_SIZE];
+    if (slot->code != PROG_NONE && slot->len == len && memcmp(slot->text, b, len) == 0) {
+        return slot->code;
+    }
+    ProgCode code = prog_intern_len(b, len);
+    if (code != PROG_NONE) {
+        memcpy(slot->text, b, len);
+        slot->len = len;
+        slot->code = code;
     }
+    return code;
+}
 
-    char line[512];
-    int skipped = 0;
+static void report_reject(ImportReport *rep, ImportReason why, size_t line) {
+    if (rep->rejected[why]++ == 0) {
+        rep->first_line[why] = line;
+    }
+}
+
+// Split a line into id, name, programme, mark. CSV rows must have exactly
+// four fields; TSV rows ignore anything after the fourth, as OPEN always has.
+static bool split_line(RowFormat format, const char *p, const char *end,
+                       char scratch[4][FIELD_MAX], const char *b[4], const char *e[4]) {
+    for (int f = 0; f < 4; f++) {
+        bool ok = format == ROWS_CSV ? next_csv_field(&p, end, scratch[f], &b[f], &e[f])
+                                     : next_field(&p, end, &b[f], &e[f]);
+        if (!ok) return false;
+        trim_range(&b[f], &e[f]);
+    }
+    return format != ROWS_CSV || p == NULL;
+}
+
+// Parse one line into out. When checking, also validate it and record why a
+// row is rejected; the database loader leaves validation to store_insert.
+static LineResult parse_line(LoadChunk *c, const char *p, const char *end, Student *out) {
+    if (end > p && end[-1] == '\r') end--; // Optional carriage return
+    if (p == end || *p == '#') {
+        return LINE_BLANK; // Skip empty lines and comments
+    }
+
+    char scratch[4][FIELD_MAX];
+    const char *b[4], *e[4];
+    if (!split_line(c->format, p, end, scratch, b, e)) {
+        if (c->check) report_reject(&c->report, IMPORT_MALFORMED, c->lines);
+        return LINE_MALFORMED;
+    }
 
-    while (fgets(line, sizeof line, fp)) {
-        strip_eol(line);
-        if (line[0] == '\0' || line[0] == '#') {
-            continue; // Skip empty lines and comments
+    // A header row names its columns instead of holding data
+    if (c->check && c->first && c->lines == 1 &&
+        e[0] - b[0] == 2 && strncasecmp(b[0], "id", 2) == 0) {
+        return LINE_BLANK;
+    }
+
+    char num[64];
+    memset(out, 0, sizeof *out);
+    copy_field(num, sizeof num, b[0], e[0]);
+    if (!parse_int(num, &out->id) || (c->check && !valid_id(out->id))) {
+        if (c->check) report_reject(&c->report, IMPORT_BAD_ID, c->lines);
+        return LINE_MALFORMED;
+    }
+    copy_field(num, sizeof num, b[3], e[3]);
+    if (!parse_float(num, &out->mark) || (c->check && !valid_mark(out->mark))) {
+        if (c->check) report_reject(&c->report, IMPORT_BAD_MARK, c->lines);
+        return LINE_MALFORMED;
+    }
+    copy_field(out->name, sizeof out->name, b[1], e[1]);
+    if (c->check) {
+        // The same name rule as INSERT, once the copy is known not to be cut short
+        if (e[1] - b[1] >= NAME_LEN || !valid_text(out->name)) {
+            report_reject(&c->report, IMPORT_BAD_NAME, c->lines);
+            return LINE_MALFORMED;
+        }
+        // A tab can only arrive inside a quoted CSV field and would break the TSV database
+        if (b[2] == e[2] || e[2] - b[2] >= FIELD_MAX || memchr(b[2], '\t', (size_t)(e[2] - b[2]))) {
+            report_reject(&c->report, IMPORT_BAD_PROGRAMME, c->lines);
+            return LINE_MALFORMED;
+        }
+    }
+    out->programme = chunk_intern(c, b[2], e[2]);
+    return LINE_OK;
+}
+
+static bool chunk_grow(LoadChunk *c) {
+    size_t new_cap = c->cap ? c->cap * 2 : 1024;
+    Student *grown = realloc(c->rows, new_cap * sizeof *grown);
+    if (!grown) return false;
+    c->rows = grown;
+    if (c->check) {
+        unsigned *lines = realloc(c->row_lines, new_cap * sizeof *lines);
+        if (!lines) return false;
+        c->row_lines = lines;
+    }
+    c->cap = new_cap;
+    return true;
+}
+
+static void *parse_chunk(void *arg) {
+    LoadChunk *c = arg;
+    const char *p = c->begin;
+    while (p < c->end) {
+        const char *nl = memchr(p, '\n', (size_t)(c->end - p));
+        const char *line_end = nl ? nl : c->end;
+        c->lines++;
+
+        if (c->count == c->cap && !chunk_grow(c)) {
+            c->skipped = -1; // Out of memory, reported by the caller
+            return NULL;
+        }
+
+        LineResult r = parse_line(c, p, line_end, &c->rows[c->count]);
+        if (r == LINE_OK) {
+            if (c->check) c->row_lines[c->count] = (unsigned)c->lines;
+            c->count++;
+        } else if (r == LINE_MALFORMED) {
+            c->skipped++;
         }
+        p = line_end + 1;
+    }
+    return NULL;
+}
+
+static void free_chunks(LoadChunk *chunks, size_t nthreads) {
+    for (size_t i = 0; i < nthreads; i++) {
+        free(chunks[i].rows);
+        free(chunks[i].row_lines);
+    }
+    free(chunks);
+}
 
-        char *id_str = strtok(line, "\t");
-        char *name_str = strtok(NULL, "\t");
-        char *programme_str = strtok(NULL, "\t");
-        char *mark_str = strtok(NULL, "\t");
+// Split buf into newline-aligned chunks and parse them in parallel. Returns
+// the chunks in file order, or NULL if out of memory.
+static LoadChunk *parse_buffer(const char *buf, size_t len, RowFormat format, bool check, size_t *out_n) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t nthreads = len / MIN_CHUNK_BYTES;
+    if (cpus > 0 && nthreads > (size_t)cpus) nthreads = (size_t)cpus;
+    if (nthreads > MAX_LOAD_THREADS) nthreads = MAX_LOAD_THREADS;
+    if (nthreads == 0) nthreads = 1;
 
-        if (!id_str || !name_str || !programme_str || !mark_str) {
-            skipped++;
-            continue; // Malformed line
+    LoadChunk *chunks = calloc(nthreads, sizeof *chunks);
+    if (!chunks) {
+        return NULL;
+    }
+    const char *end = buf + len;
+    const char *p = buf;
+    for (size_t i = 0; i < nthreads; i++) {
+        const char *cut = (i + 1 == nthreads) ? end : buf + len / nthreads * (i + 1);
+        if (cut < p) cut = p;
+        if (cut < end) {
+            const char *nl = memchr(cut, '\n', (size_t)(end - cut));
+            cut = nl ? nl + 1 : end;
         }
+        chunks[i].begin = p;
+        chunks[i].end = cut;
+        chunks[i].format = format;
+        chunks[i].check = check;
+        chunks[i].first = i == 0;
+        p = cut;
+    }
 
-        // Trim whitespace
-        str_trim(id_str); str_trim(name_str); str_trim(programme_str); str_trim(mark_str);
+    pthread_t tids[MAX_LOAD_THREADS];
+    bool started[MAX_LOAD_THREADS] = {false};
+    for (size_t i = 1; i < nthreads; i++) {
+        started[i] = pthread_create(&tids[i], NULL, parse_chunk, &chunks[i]) == 0;
+    }
+    parse_chunk(&chunks[0]);
+    for (size_t i = 1; i < nthreads; i++) {
+        if (started[i]) pthread_join(tids[i], NULL);
+        else parse_chunk(&chunks[i]); // Thread creation failed, parse inline
+    }
 
-        int id;
-        float mark;
-        if (!parse_int(id_str, &id) || !parse_float(mark_str, &mark)) {
-            skipped++;
-            continue; // Parsing error
+    for (size_t i = 0; i < nthreads; i++) {
+        if (chunks[i].skipped < 0) {
+            free_chunks(chunks, nthreads);
+            return NULL;
         }
+    }
+    *out_n = nthreads;
+    return chunks;
+}
 
-        Student st = {0};
-        st.id = id;
-        st.mark = mark;
-        strncpy(st.name, name_str, sizeof st.name); st.name[sizeof st.name - 1] = '\0';
-        strncpy(st.programme, programme_str, sizeof st.programme); st.programme[sizeof st.programme - 1] = '\0';
+// Parse buf in parallel and merge in file order
+static bool load_buffer(const char *buf, size_t len, Store *s, int *skipped_lines) {
+    size_t nthreads = 0;
+    LoadChunk *chunks = parse_buffer(buf, len, ROWS_TSV, false, &nthreads);
+    if (!chunks) {
+        return false;
+    }
+
+    size_t total = 0;
+    for (size_t i = 0; i < nthreads; i++) {
+        total += chunks[i].count;
+    }
 
-        if(!store_insert(s, st)) {
-            skipped++;
-            continue; // Invalid data or duplicate
+    // Merge sequentially: first occurrence of an ID wins, later duplicates are skipped
+    bool ok = true;
+    int skipped = 0;
+    if (store_reserve(s, s->size + total)) {
+        for (size_t i = 0; i < nthreads; i++) {
+            skipped += chunks[i].skipped;
+            for (size_t r = 0; r < chunks[i].count; r++) {
+                if (!store_insert(s, chunks[i].rows[r])) {
+                    skipped++; // Invalid data or duplicate
+                }
+            }
         }
+    } else {
+        ok = false;
     }
 
-    fclose(fp);
-    if (skipped_lines) {
+    free_chunks(chunks, nthreads);
+    if (ok && skipped_lines) {
         *skipped_lines = skipped;
     }
+    return ok;
+}
+
+// Parse rows that were validated in their chunk, then append them with one
+// capacity reservation. A single ID lookup per row separates clashes with the
+// existing store from repeats within the file: rows added by this import sit
+// at or after the store's old size.
+static bool import_buffer(const char *buf, size_t len, RowFormat format, Store *s, ImportReport *rep) {
+    size_t nthreads = 0;
+    LoadChunk *chunks = parse_buffer(buf, len, format, true, &nthreads);
+    if (!chunks) {
+        return false;
+    }
 
+    size_t total = 0;
+    for (size_t i = 0; i < nthreads; i++) {
+        total += chunks[i].count;
+    }
+    if (!store_reserve(s, s->size + total)) {
+        free_chunks(chunks, nthreads);
+        return false;
+    }
+
+    size_t base = s->size;
+    size_t line_base = 0;
+    for (size_t i = 0; i < nthreads; i++) {
+        const LoadChunk *c = &chunks[i];
+        for (int r = 0; r < IMPORT_REASONS; r++) {
+            if (c->report.rejected[r] && rep->rejected[r] == 0) {
+                rep->first_line[r] = line_base + c->report.first_line[r];
+            }
+            rep->rejected[r] += c->report.rejected[r];
+        }
+        for (size_t r = 0; r < c->count; r++) {
+            int slot = store_find_index_by_id(s, c->rows[r].id);
+            if (slot >= 0) {
+                report_reject(rep, (size_t)slot >= base ? IMPORT_DUP_FILE : IMPORT_DUP_STORE,
+                              line_base + c->row_lines[r]);
+            } else if (c->rows[r].programme == PROG_NONE) {
+                // The programme dictionary could not take it
+                report_reject(rep, IMPORT_BAD_PROGRAMME, line_base + c->row_lines[r]);
+            } else if (store_insert_trusted(s, c->rows[r])) {
+                rep->added++;
+            } else {
+                report_reject(rep, IMPORT_STORE_FAILED, line_base + c->row_lines[r]);
+            }
+        }
+        line_base += c->lines;
+    }
+
+    free_chunks(chunks, nthreads);
     return true;
 }
 
-bool cms_save(const char *path, const Store *s) {
+// Fallback for files that cannot be mapped (pipes, special files)
+static char *read_all(int fd, size_t *out_len) {
+    size_t cap = 1 << 16, len = 0;
+    char *buf = malloc(cap);
+    if (!buf) return NULL;
+    for (;;) {
+        if (len == cap) {
+            char *grown = realloc(buf, cap * 2);
+            if (!grown) {
+                free(buf);
+                return NULL;
+            }
+            buf = grown;
+            cap *= 2;
+        }
+        ssize_t n = read(fd, buf + len, cap - len);
+        if (n < 0) {
+            free(buf);
+            return NULL;
+        }
+        if (n == 0) break;
+        len += (size_t)n;
+    }
+    *out_len = len;
+    return buf;
+}
+
+// Whole-file contents, mapped where possible. *mapped tells release_file how to free it.
+static char *acquire_file(const char *path, size_t *len, bool *mapped) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat sb;
+    *mapped = false;
+    if (fstat(fd, &sb) == 0 && S_ISREG(sb.st_mode)) {
+        *len = (size_t)sb.st_size;
+        if (*len == 0) {
+            close(fd);
+            return calloc(1, 1);
+        }
+        void *map = mmap(NULL, *len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            close(fd);
+            madvise(map, *len, MADV_SEQUENTIAL);
+            *mapped = true;
+            return map;
+        }
+    }
+
+    char *buf = read_all(fd, len);
+    close(fd);
+    return buf;
+}
+
+static void release_file(char *buf, size_t len, bool mapped) {
+    if (mapped) munmap(buf, len);
+    else free(buf);
+}
+
+static bool has_ext(const char *path, const char *ext) {
+    size_t len = strlen(path), n = strlen(ext);
+    return len >= n && strcasecmp(path + len - n, ext) == 0;
+}
+
+static bool has_snapshot_ext(const char *path) {
+    return has_ext(path, SNAPSHOT_EXT);
+}
+
+bool cms_load(const char *path, Store *s, int *skipped_lines) {
+    if (snapshot_is_binary(path)) {
+        if (skipped_lines) *skipped_lines = 0; // Snapshot rows were validated when written
+        struct stat sb;
+        if (stat(path, &sb) == 0) metrics_add(METRIC_BYTES_READ, (uint64_t)sb.st_size);
+        return snapshot_load(path, s);
+    }
+
+    size_t len = 0;
+    bool mapped = false;
+    char *buf = acquire_file(path, &len, &mapped);
+    if (!buf) {
+        return false; // File missing is not fatal, caller proceeds with empty store
+    }
+    metrics_add(METRIC_BYTES_READ, len);
+    bool ok = load_buffer(buf, len, s, skipped_lines);
+    release_file(buf, len, mapped);
+    return ok;
+}
+
+bool cms_import(const char *path, Store *s, ImportReport *rep) {
+    memset(rep, 0, sizeof *rep);
+    size_t len = 0;
+    bool mapped = false;
+    char *buf = acquire_file(path, &len, &mapped);
+    if (!buf) {
+        return false;
+    }
+    metrics_add(METRIC_BYTES_READ, len);
+    bool ok = import_buffer(buf, len, has_ext(path, ".csv") ? ROWS_CSV : ROWS_TSV, s, rep);
+    release_file(buf, len, mapped);
+    return ok;
+}
+
+const char *import_reason_name(ImportReason why) {
+    static const char *const names[IMPORT_REASONS] = {
+        [IMPORT_MALFORMED] = "malformed line",
+        [IMPORT_BAD_ID] = "invalid ID",
+        [IMPORT_BAD_NAME] = "invalid name",
+        [IMPORT_BAD_PROGRAMME] = "invalid programme",
+        [IMPORT_BAD_MARK] = "invalid mark",
+        [IMPORT_DUP_STORE] = "ID already in database",
+        [IMPORT_DUP_FILE] = "ID repeated in file",
+        [IMPORT_STORE_FAILED] = "could not store row",
+    };
+    return why < IMPORT_REASONS ? names[why] : "unknown";
+}
+
+static bool save_tsv(const char *path, const Store *s) {
     FILE *fp = fopen(path, "w");
     if (!fp) {
         return false; // Unable to open file for writing
     }
 
     for (size_t i = 0; i < s->size; i++) {
-        const Student *st = &s->data[i];
-        fprintf(fp, "%d\t%s\t%s\t%.1f\n", st->id, st->name, st->programme, st->mark);
+        fprintf(fp, "%d\t%s\t%s\t%.1f\n", s->ids[i], store_name(s, i), prog_name(s->progs[i]), s->marks[i]);
     }
 
-    fclose(fp);
-    return true;
-}
\ No newline at end of file
+    // A full disk shows up as a write error on the stream or at close
+    bool ok = !ferror(fp);
+    if (fclose(fp) != 0) ok = false;
+    return ok;
+}
+
+// Flush a written file to disk
+static bool sync_file(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = fsync(fd) == 0;
+    if (close(fd) != 0) ok = false;
+    return ok;
+}
+
+// Make a rename in path's directory durable
+static bool sync_parent_dir(const char *path) {
+    char dir[512];
+    const char *slash = strrchr(path, '/');
+    if (!slash) {
+        strcpy(dir, ".");
+    } else if (slash == path) {
+        strcpy(dir, "/");
+    } else if ((size_t)(slash - path) >= sizeof dir) {
+        return false;
+    } else {
+        memcpy(dir, path, (size_t)(slash - path));
+        dir[slash - path] = '\0';
+    }
+    int fd = open(dir, O_RDONLY | O_DIRECTORY);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = fsync(fd) == 0;
+    if (close(fd) != 0) ok = false;
+    return ok;
+}
+
+// Keep the format of an existing file, otherwise choose by extension. The
+// rows go to <path>.tmp, which is synced and renamed over path, so a crash
+// leaves either the old file or the new one.
+bool cms_save(const char *path, const Store *s) {
+    char tmp[512];
+    if ((size_t)snprintf(tmp, sizeof tmp, "%s%s", path, SAVE_TMP_SUFFIX) >= sizeof tmp) {
+        return false;
+    }
+    bool snapshot = has_snapshot_ext(path) || snapshot_is_binary(path);
+    bool ok = snapshot ? snapshot_save(tmp, s) : save_tsv(tmp, s);
+    struct stat sb;
+    if (ok && stat(tmp, &sb) == 0) metrics_add(METRIC_BYTES_WRITTEN, (uint64_t)sb.st_size);
+    ok = ok && sync_file(tmp) && rename(tmp, path) == 0;
+    if (!ok) {
+        remove(tmp);
+        return false;
+    }
+    return sync_parent_dir(path);
+}
+
+bool cms_convert(const char *src, const char *dst, size_t *rows, int *skipped_lines) {
+    Store tmp;
+    store_init(&tmp);
+    bool ok = cms_load(src, &tmp, skipped_lines);
+    if (ok) {
+        ok = has_snapshot_ext(dst) ? snapshot_save(dst, &tmp) : save_tsv(dst, &tmp);
+    }
+    if (rows) *rows = tmp.size;
+    store_free(&tmp);
+    return ok;
+}
@@ -0,0 +1,262 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "journal.h"
+#include "util.h"
+
+// Record formats, one per line, tab-separated:
+//   I <id> <name> <programme> <mark>
+//   U <id> <new id|-1> <name|""> <programme|""> <mark|-1>
+//   D <id>
+//   C                                  (end of a committed batch)
+
+void journal_init(Journal *j, const char *db_path) {
+    snprintf(j->path, sizeof j->path, "%s%s", db_path, JOURNAL_SUFFIX);
+    j->buf = NULL;
+    j->len = 0;
+    j->cap = 0;
+    j->pending = 0;
+    j->committed = -1;
+}
+
+void journal_free(Journal *j) {
+    free(j->buf);
+    j->buf = NULL;
+    j->len = 0;
+    j->cap = 0;
+    j->pending = 0;
+}
+
+static bool journal_append(Journal *j, const char *fmt, ...) {
+    for (;;) {
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(j->buf ? j->buf + j->len : NULL, j->cap - j->len, fmt, ap);
+        va_end(ap);
+        if (n < 0) return false;
+        if (j->len + (size_t)n < j->cap) {
+            j->len += (size_t)n;
+            return true;
+        }
+        size_t new_cap = j->cap ? j->cap * 2 : 4096;
+        while (new_cap <= j->len + (size_t)n) new_cap *= 2;
+        char *grown = realloc(j->buf, new_cap);
+        if (!grown) return false;
+        j->buf = grown;
+        j->cap = new_cap;
+    }
+}
+
+bool journal_log_insert(Journal *j, const Student *st) {
+    if (!journal_append(j, "I\t%d\t%s\t%s\t%.9g\n", st->id, st->name, prog_name(st->programme), st->mark)) {
+        return false;
+    }
+    j->pending++;
+    return true;
+}
+
+bool journal_log_update(Journal *j, int id, const Student *patch) {
+    if (!journal_append(j, "U\t%d\t%d\t%s\t%s\t%.9g\n", id, patch->id, patch->name, prog_name(patch->programme), patch->mark)) {
+        return false;
+    }
+    j->pending++;
+    return true;
+}
+
+bool journal_log_delete(Journal *j, int id) {
+    if (!journal_append(j, "D\t%d\n", id)) {
+        return false;
+    }
+    j->pending++;
+    return true;
+}
+
+// Cut fd back to the committed length, dropping a torn batch
+static bool drop_tail(int fd, long committed) {
+    return ftruncate(fd, (off_t)committed) == 0 && fsync(fd) == 0;
+}
+
+bool journal_commit(Journal *j) {
+    if (j->pending == 0) {
+        return true;
+    }
+    if (!journal_append(j, "C\n")) {
+        return false;
+    }
+
+    int fd = open(j->path, O_WRONLY | O_CREAT, 0644);
+    if (fd < 0) {
+        j->len -= 2; // Keep the batch pending for the next attempt
+        return false;
+    }
+    if (j->committed < 0) {
+        // Not replayed: a journal started after a full save holds only commits
+        struct stat sb;
+        j->committed = fstat(fd, &sb) == 0 ? (long)sb.st_size : 0;
+    }
+
+    // Write after the last commit, over any bytes a failed attempt left behind
+    size_t off = 0;
+    bool ok = drop_tail(fd, j->committed) && lseek(fd, (off_t)j->committed, SEEK_SET) >= 0;
+    while (ok && off < j->len) {
+        ssize_t n = write(fd, j->buf + off, j->len - off);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        off += (size_t)n;
+    }
+    ok = ok && off == j->len && fsync(fd) == 0;
+
+    if (ok) {
+        j->committed += (long)j->len;
+        j->len = 0;
+        j->pending = 0;
+    } else {
+        // Keep the batch pending and leave no part of it on disk for the retry
+        // or a later replay to pick up. If even that fails, the next attempt
+        // truncates again before writing.
+        drop_tail(fd, j->committed);
+        j->len -= 2;
+    }
+    if (close(fd) != 0) ok = false;
+    return ok;
+}
+
+void journal_discard(Journal *j) {
+    j->len = 0;
+    j->pending = 0;
+}
+
+bool journal_truncate(Journal *j) {
+    int fd = open(j->path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = fsync(fd) == 0;
+    if (close(fd) != 0) ok = false;
+    if (ok) j->committed = 0;
+    return ok;
+}
+
+// Split line on tabs, keeping empty fields. Returns the number of fields.
+static int split_fields(char *line, char **fields, int max) {
+    int n = 0;
+    fields[n++] = line;
+    for (char *p = line; *p && n < max; p++) {
+        if (*p == '\t') {
+            *p = '\0';
+            fields[n++] = p + 1;
+        }
+    }
+    return n;
+}
+
+static bool apply_record(Store *s, char **f, int n) {
+    int id;
+    if (n < 2 || !parse_int(f[1], &id)) return false;
+
+    if (f[0][0] == 'I' && n == 5) {
+        Student st = {0};
+        st.id = id;
+        snprintf(st.name, sizeof st.name, "%s", f[2]);
+        st.programme = prog_intern(f[3]);
+        return parse_float(f[4], &st.mark) && store_insert(s, st);
+    }
+    if (f[0][0] == 'U' && n == 6) {
+        Student patch = {0};
+        snprintf(patch.name, sizeof patch.name, "%s", f[3]);
+        patch.programme = prog_intern(f[4]);
+        return parse_int(f[2], &patch.id) && parse_float(f[5], &patch.mark) &&
+               store_update(s, id, &patch);
+    }
+    if (f[0][0] == 'D' && n == 2) {
+        return store_delete(s, id);
+    }
+    return false;
+}
+
+// Length of the file through its last complete commit marker
+static long committed_length(FILE *fp) {
+    long committed = 0;
+    char line[512];
+    rewind(fp);
+    while (fgets(line, sizeof line, fp)) {
+        if (strcmp(line, "C\n") == 0) committed = ftell(fp);
+    }
+    return committed;
+}
+
+bool journal_replay(Journal *j, Store *s, size_t *applied, size_t *failed) {
+    *applied = 0;
+    *failed = 0;
+    FILE *fp = fopen(j->path, "r");
+    if (!fp) {
+        j->committed = 0;
+        return true; // No journal yet
+    }
+
+    // Collect a batch and only apply it once its commit marker is seen
+    char **batch = NULL;
+    size_t count = 0, cap = 0;
+    bool ok = true;
+    char line[512];
+    while (fgets(line, sizeof line, fp)) {
+        char *nl = strchr(line, '\n');
+        if (!nl) break; // Torn tail
+        *nl = '\0';
+
+        if (strcmp(line, "C") == 0) {
+            for (size_t i = 0; i < count; i++) {
+                char *f[6];
+                int n = split_fields(batch[i], f, 6);
+                if (apply_record(s, f, n)) (*applied)++;
+                else (*failed)++;
+                free(batch[i]);
+            }
+            count = 0;
+            continue;
+        }
+
+        if (count == cap) {
+            size_t new_cap = cap ? cap * 2 : 64;
+            char **grown = realloc(batch, new_cap * sizeof *grown);
+            if (!grown) {
+                ok = false;
+                break;
+            }
+            batch = grown;
+            cap = new_cap;
+        }
+        batch[count] = strdup(line);
+        if (!batch[count]) {
+            ok = false;
+            break;
+        }
+        count++;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        free(batch[i]); // Uncommitted tail
+    }
+    free(batch);
+
+    // Cut the uncommitted tail off now; left in place, the next commit would
+    // append its marker after it and adopt it
+    long committed = committed_length(fp);
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fclose(fp);
+    if (committed >= 0 && size > committed) {
+        int fd = open(j->path, O_WRONLY);
+        if (fd < 0 || !drop_tail(fd, committed)) ok = false;
+        if (fd >= 0) close(fd);
+    }
+    j->committed = committed;
+    return ok;
+}
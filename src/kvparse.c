@@ -0,0 +1,147 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include "kvparse.h"
+#include "util.h"
+
+typedef enum {
+    KEY_NONE,
+    KEY_ID,
+    KEY_NAME,
+    KEY_PROGRAMME,
+    KEY_MARK
+} FieldKey;
+
+// Key spelled by the letters [p, p + len)
+static FieldKey key_of(const char *p, size_t len) {
+    switch (len) {
+    case 2: return strncasecmp(p, "id", 2) == 0 ? KEY_ID : KEY_NONE;
+    case 4:
+        if (strncasecmp(p, "name", 4) == 0) return KEY_NAME;
+        return strncasecmp(p, "mark", 4) == 0 ? KEY_MARK : KEY_NONE;
+    case 9: return strncasecmp(p, "programme", 9) == 0 ? KEY_PROGRAMME : KEY_NONE;
+    default: return KEY_NONE;
+    }
+}
+
+static size_t word_len(const char *p) {
+    size_t len = 0;
+    while (isalpha((unsigned char)p[len])) len++;
+    return len;
+}
+
+// True if p starts another field: a known key followed by '='
+static bool at_field(const char *p) {
+    size_t len = word_len(p);
+    if (key_of(p, len) == KEY_NONE) return false;
+    p += len;
+    while (isspace((unsigned char)*p)) p++;
+    return *p == '=';
+}
+
+// Decode the value at *pp in place and nul-terminate it. On return *out
+// holds it, *len its length, and *pp points past it.
+static bool take_value(char **pp, const char **out, size_t *len, const char *key, size_t key_len, FILE *err) {
+    char *p = *pp;
+    while (isspace((unsigned char)*p)) p++;
+
+    if (*p == '"') {
+        char *start = ++p, *w = start;
+        while (*p && *p != '"') {
+            if (*p == '\\' && p[1]) p++;
+            *w++ = *p++;
+        }
+        if (*p != '"') {
+            fprintf(err, "Malformed key-value pair: Unterminated quote in value for key %.*s.\n", (int)key_len, key);
+            return false;
+        }
+        *pp = p + 1;
+        *w = '\0';     // At or before the closing quote
+        *out = start;
+        *len = (size_t)(w - start);
+        return true;
+    }
+
+    if (at_field(p)) { // Empty value, e.g. Name= ID=7
+        *out = "";
+        *len = 0;
+        *pp = p;
+        return true;
+    }
+
+    // Bare text: stop where whitespace is followed by the next key, leaving
+    // *pp past that whitespace so the terminator cannot land on unread input
+    char *start = p, *end = p;
+    while (*p) {
+        if (isspace((unsigned char)*p)) {
+            char *next = p;
+            while (isspace((unsigned char)*next)) next++;
+            p = next;
+            if (at_field(next)) break;
+            continue;
+        }
+        end = ++p;
+    }
+    *end = '\0';
+    *out = start;
+    *len = (size_t)(end - start);
+    *pp = p;
+    return true;
+}
+
+bool kv_parse_student(char *args, Student *patch, char *programme, FILE *err) {
+    char *p = args;
+    for (;;) {
+        while (isspace((unsigned char)*p)) p++;
+        if (*p == '\0') return true;
+
+        char *key = p;
+        size_t key_len = word_len(p);
+        FieldKey field = key_of(p, key_len);
+        if (field == KEY_NONE) {
+            fprintf(err, "Malformed key-value pair: Unknown key at '%s'. Use ID, Name, Programme, Mark.\n", key);
+            return false;
+        }
+        p += key_len;
+        while (isspace((unsigned char)*p)) p++;
+        if (*p != '=') {
+            fprintf(err, "Malformed key-value pair: Missing or invalid '=' after key %.*s.\n", (int)key_len, key);
+            return false;
+        }
+        p++;
+
+        const char *value;
+        size_t len;
+        if (!take_value(&p, &value, &len, key, key_len, err)) {
+            return false;
+        }
+
+        switch (field) {
+        case KEY_ID:
+            if (!parse_int(value, &patch->id)) {
+                fprintf(err, "Invalid ID value: %s\n", value);
+                return false;
+            }
+            break;
+        case KEY_NAME:
+            if (len > sizeof patch->name - 1) len = sizeof patch->name - 1;
+            memcpy(patch->name, value, len);
+            patch->name[len] = '\0';
+            break;
+        case KEY_PROGRAMME:
+            if (len > KV_PROG_LEN - 1) len = KV_PROG_LEN - 1;
+            memcpy(programme, value, len);
+            programme[len] = '\0';
+            break;
+        case KEY_MARK:
+            if (!parse_float(value, &patch->mark)) {
+                fprintf(err, "Invalid Mark value: %s\n", value);
+                return false;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+}
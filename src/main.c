@@ -1,22 +1,123 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include "cmd.h"
+#include "metrics.h"
+#include "server.h"
 #include "store.h"
+#include "util.h"
 
 #define DB_FILENAME "db/P6_5-CMS.txt" // Change TeamName
+#define BATCH_BUF_SIZE (1 << 20)      // stdout buffer in batch mode
+#define METRICS_DEFAULT_INTERVAL 60   // Seconds between --metrics reports
 
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [--batch | --script <file> | --serve <socket>] [--metrics <file> [--metrics-interval <s>]]\n", prog);
+    fprintf(stderr, "  --batch, -b          Run commands from stdin without prompts or confirmations\n");
+    fprintf(stderr, "  --script, -f <file>  Same, reading commands from <file>\n");
+    fprintf(stderr, "  --serve, -s <socket> Load the database and serve commands on a Unix socket\n");
+    fprintf(stderr, "  --metrics <file>     Append the METRICS report to <file> periodically and at exit\n");
+    fprintf(stderr, "  --metrics-interval <s> Seconds between reports (default %d)\n", METRICS_DEFAULT_INTERVAL);
+}
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Run every command in `in` with fully buffered output. Blank lines and lines
+// starting with '#' are skipped. Throughput goes to stderr so stdout holds
+// only command output.
+static void run_batch(FILE *in, Store *store) {
+    static char out_buf[BATCH_BUF_SIZE];
+    setvbuf(stdout, out_buf, _IOFBF, sizeof out_buf);
+    cmd_set_batch(true);
+
+    char line[512];
+    size_t commands = 0;
+    double t0 = now_sec();
+    while (fgets(line, sizeof line, in)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        const char *p = line + strspn(line, " \t");
+        if (*p == '\0' || *p == '#') continue;
+        commands++;
+        if (!cmd_process_line(p, store, DB_FILENAME)) break;
+    }
+    double elapsed = now_sec() - t0;
+
+    fflush(stdout);
+    fprintf(stderr, "Batch: %zu command(s) in %.3f s (%.0f commands/s)\n",
+            commands, elapsed, elapsed > 0 ? (double)commands / elapsed : 0.0);
+}
+
+int main(int argc, char **argv) {
+    bool batch = false;
+    const char *script = NULL;
+    const char *socket_path = NULL;
+    const char *metrics_path = NULL;
+    int metrics_interval = METRICS_DEFAULT_INTERVAL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--batch") == 0 || strcmp(argv[i], "-b") == 0) {
+            batch = true;
+        } else if ((strcmp(argv[i], "--script") == 0 || strcmp(argv[i], "-f") == 0) && i + 1 < argc) {
+            batch = true;
+            script = argv[++i];
+        } else if ((strcmp(argv[i], "--serve") == 0 || strcmp(argv[i], "-s") == 0) && i + 1 < argc) {
+            socket_path = argv[++i];
+        } else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+            metrics_path = argv[++i];
+        } else if (strcmp(argv[i], "--metrics-interval") == 0 && i + 1 < argc &&
+                   parse_int(argv[i + 1], &metrics_interval) && metrics_interval > 0) {
+            i++;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    // Create and initialize store
+    Store store;
+    store_init(&store);
+
+    if (batch && socket_path) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (metrics_path && !metrics_dump_start(metrics_path, (unsigned)metrics_interval)) {
+        perror(metrics_path);
+        return 1;
+    }
+
+    if (socket_path) {
+        cmd_process_line("OPEN", &store, DB_FILENAME);
+        bool served = server_run(socket_path, &store, DB_FILENAME);
+        cmd_wait_saved(&store);
+        metrics_dump_stop();
+        store_free(&store);
+        return served ? 0 : 1;
+    }
+
+    if (batch) {
+        FILE *in = script ? fopen(script, "r") : stdin;
+        if (!in) {
+            perror(script);
+            metrics_dump_stop();
+            return 1;
+        }
+        run_batch(in, &store);
+        if (in != stdin) fclose(in);
+        metrics_dump_stop();
+        store_free(&store);
+        return 0;
+    }
 
-int main(void) {
     // Print the exact non-plagiarism declaration block per assignment
     char datebuf[32];
     time_t now = time(NULL); struct tm *lt = localtime(&now);
     strftime(datebuf, sizeof datebuf, "%Y-%m-%d", lt);
     print_declaration("LAB-P6-5", "CHESTON LEROY ONG (2502701)\nAARON ALISON SILVA (2500461)\nAFIQAH BINTE MOHAMED ADNAN (2503067)\nANDREW CHIA KAI XUN BEDINA (2501298)\nCHUA JIA JUN (2500533)\n", datebuf);
-
-    // Create and initialize store
-    Store store;
-    store_init(&store);
     
     // Print program header
     printf("============================================\n");
@@ -38,7 +139,15 @@ int main(void) {
        }
 
 
-       // On exit, you may prompt to save unsaved changes (TODO: track dirty flag)
+       // Let a background SAVE finish, then offer to save what is still unsaved
+       if (cmd_wait_saved(&store)) {
+           printf("There are unsaved changes. Save before exiting? (y/n): "); fflush(stdout);
+           if (fgets(line, sizeof line, stdin) && (line[0] == 'y' || line[0] == 'Y')) {
+               cmd_process_line("SAVE", &store, DB_FILENAME);
+               cmd_wait_saved(&store);
+           }
+       }
+       metrics_dump_stop();
        store_free(&store);
        puts("Thank you for using CMS.\nGoodbye.");
        return 0;
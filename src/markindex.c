@@ -0,0 +1,211 @@
+#include <stdlib.h>
+#include <string.h>
+#include "markindex.h"
+
+static unsigned next_prio(MarkIndex *mi) {
+    // xorshift32, deterministic so runs are reproducible
+    unsigned x = mi->seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    mi->seed = x;
+    return x;
+}
+
+static int key_cmp(float am, int aid, float bm, int bid) {
+    if (am != bm) return am < bm ? -1 : 1;
+    return (aid > bid) - (aid < bid);
+}
+
+void markindex_init(MarkIndex *mi) {
+    mi->nodes = NULL;
+    mi->used = 0;
+    mi->cap = 0;
+    mi->free_list = -1;
+    mi->root = -1;
+    mi->seed = 2463534242u;
+}
+
+void markindex_free(MarkIndex *mi) {
+    free(mi->nodes);
+    markindex_init(mi);
+}
+
+static int alloc_node(MarkIndex *mi, float mark, int id) {
+    int n;
+    if (mi->free_list >= 0) {
+        n = mi->free_list;
+        mi->free_list = mi->nodes[n].left;
+    } else {
+        if (mi->used == mi->cap) {
+            size_t new_cap = mi->cap ? mi->cap * 2 : 64;
+            MarkNode *grown = realloc(mi->nodes, new_cap * sizeof *grown);
+            if (!grown) return -1;
+            mi->nodes = grown;
+            mi->cap = new_cap;
+        }
+        n = (int)mi->used++;
+    }
+    MarkNode *node = &mi->nodes[n];
+    node->mark = mark;
+    node->id = id;
+    node->left = node->right = -1;
+    node->prio = next_prio(mi);
+    return n;
+}
+
+// Split t into keys < (mark, id) and keys >= (mark, id)
+static void split(MarkNode *nodes, int t, float mark, int id, int *l, int *r) {
+    if (t < 0) {
+        *l = *r = -1;
+        return;
+    }
+    if (key_cmp(nodes[t].mark, nodes[t].id, mark, id) < 0) {
+        split(nodes, nodes[t].right, mark, id, &nodes[t].right, r);
+        *l = t;
+    } else {
+        split(nodes, nodes[t].left, mark, id, l, &nodes[t].left);
+        *r = t;
+    }
+}
+
+// Join two treaps where every key in l is below every key in r
+static int merge(MarkNode *nodes, int l, int r) {
+    if (l < 0) return r;
+    if (r < 0) return l;
+    if (nodes[l].prio > nodes[r].prio) {
+        nodes[l].right = merge(nodes, nodes[l].right, r);
+        return l;
+    }
+    nodes[r].left = merge(nodes, l, nodes[r].left);
+    return r;
+}
+
+static int insert_node(MarkNode *nodes, int t, int n) {
+    if (t < 0) return n;
+    if (nodes[n].prio > nodes[t].prio) {
+        split(nodes, t, nodes[n].mark, nodes[n].id, &nodes[n].left, &nodes[n].right);
+        return n;
+    }
+    if (key_cmp(nodes[n].mark, nodes[n].id, nodes[t].mark, nodes[t].id) < 0) {
+        nodes[t].left = insert_node(nodes, nodes[t].left, n);
+    } else {
+        nodes[t].right = insert_node(nodes, nodes[t].right, n);
+    }
+    return t;
+}
+
+bool markindex_insert(MarkIndex *mi, float mark, int id) {
+    int n = alloc_node(mi, mark, id);
+    if (n < 0) return false;
+    mi->root = insert_node(mi->nodes, mi->root, n);
+    return true;
+}
+
+void markindex_remove(MarkIndex *mi, float mark, int id) {
+    int *link = &mi->root;
+    while (*link >= 0) {
+        MarkNode *node = &mi->nodes[*link];
+        int c = key_cmp(mark, id, node->mark, node->id);
+        if (c == 0) {
+            int victim = *link;
+            *link = merge(mi->nodes, node->left, node->right);
+            mi->nodes[victim].left = mi->free_list;
+            mi->free_list = victim;
+            return;
+        }
+        link = c < 0 ? &node->left : &node->right;
+    }
+}
+
+typedef struct {
+    float mark;
+    int id;
+} MarkKey;
+
+static int cmp_key(const void *a, const void *b) {
+    const MarkKey *x = a, *y = b;
+    return key_cmp(x->mark, x->id, y->mark, y->id);
+}
+
+bool markindex_build(MarkIndex *mi, const float *marks, const int *ids, size_t n) {
+    markindex_free(mi);
+    if (n == 0) return true;
+
+    MarkKey *keys = malloc(n * sizeof *keys);
+    int *stack = malloc(n * sizeof *stack);
+    mi->nodes = malloc(n * sizeof *mi->nodes);
+    if (!keys || !stack || !mi->nodes) {
+        free(keys);
+        free(stack);
+        markindex_free(mi);
+        return false;
+    }
+    mi->cap = n;
+    for (size_t i = 0; i < n; i++) {
+        keys[i].mark = marks[i];
+        keys[i].id = ids[i];
+    }
+    qsort(keys, n, sizeof *keys, cmp_key);
+
+    // Cartesian tree over the sorted keys: O(n) with a right-spine stack
+    size_t depth = 0;
+    for (size_t i = 0; i < n; i++) {
+        int cur = alloc_node(mi, keys[i].mark, keys[i].id);
+        int last = -1;
+        while (depth > 0 && mi->nodes[stack[depth - 1]].prio < mi->nodes[cur].prio) {
+            last = stack[--depth];
+        }
+        mi->nodes[cur].left = last;
+        if (depth > 0) mi->nodes[stack[depth - 1]].right = cur;
+        stack[depth++] = cur;
+    }
+    mi->root = stack[0];
+
+    free(keys);
+    free(stack);
+    return true;
+}
+
+static bool above_lo(const MarkNode *node, const MarkRange *r) {
+    return r->lo_incl ? node->mark >= r->lo : node->mark > r->lo;
+}
+
+static bool below_hi(const MarkNode *node, const MarkRange *r) {
+    return r->hi_incl ? node->mark <= r->hi : node->mark < r->hi;
+}
+
+static size_t visit_range(const MarkNode *nodes, int t, const MarkRange *r, MarkVisitFn fn, void *ctx) {
+    size_t count = 0;
+    while (t >= 0) {
+        const MarkNode *node = &nodes[t];
+        bool lo_ok = above_lo(node, r);
+        bool hi_ok = below_hi(node, r);
+        if (lo_ok) count += visit_range(nodes, node->left, r, fn, ctx);
+        if (lo_ok && hi_ok) {
+            fn(node->id, ctx);
+            count++;
+        }
+        if (!hi_ok) break;
+        t = node->right; // Tail step instead of recursing on the right
+    }
+    return count;
+}
+
+size_t markindex_range(const MarkIndex *mi, MarkRange r, MarkVisitFn fn, void *ctx) {
+    return visit_range(mi->nodes, mi->root, &r, fn, ctx);
+}
+
+int markindex_min_id(const MarkIndex *mi) {
+    int t = mi->root;
+    if (t < 0) return -1;
+    while (mi->nodes[t].left >= 0) t = mi->nodes[t].left;
+    return mi->nodes[t].id;
+}
+
+int markindex_max_id(const MarkIndex *mi) {
+    int t = mi->root;
+    if (t < 0) return -1;
+    while (mi->nodes[t].right >= 0) t = mi->nodes[t].right;
+    return mi->nodes[t].id;
+}
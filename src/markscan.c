@@ -0,0 +1,436 @@
+#include <float.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include "markscan.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MARKSCAN_X86 1
+#endif
+
+#define SUM_LANES 16
+
+typedef struct {
+    void (*stats)(const float *marks, size_t n, MarkScanStats *out);
+    size_t (*filter)(const float *marks, size_t n, float lo, float hi, int *out);
+} MarkScanOps;
+
+static inline int band_of(float m) {
+    if (m >= GRADE_A_MIN) return 0;
+    if (m >= GRADE_B_MIN) return 1;
+    if (m >= GRADE_C_MIN) return 2;
+    if (m >= GRADE_D_MIN) return 3;
+    return 4;
+}
+
+// Fixed pairwise order so every kernel rounds the same way
+static double reduce_lanes(double *lane) {
+    for (size_t w = SUM_LANES / 2; w > 0; w /= 2) {
+        for (size_t j = 0; j < w; j++) {
+            lane[j] += lane[j + w];
+        }
+    }
+    return lane[0];
+}
+
+// Band counts from per-threshold tallies (marks >= A, B, C, D floors)
+static void set_bands(MarkScanStats *out, size_t total, const size_t ge[4]) {
+    out->band[0] = ge[0];
+    out->band[1] = ge[1] - ge[0];
+    out->band[2] = ge[2] - ge[1];
+    out->band[3] = ge[3] - ge[2];
+    out->band[4] = total - ge[3];
+}
+
+// Merge per-lane extremes; equal values resolve to the earlier slot
+static void pick_extremes(MarkScanStats *out, size_t w, const float *vmin, const int32_t *imin,
+                          const float *vmax, const int32_t *imax) {
+    out->min = vmin[0];
+    out->min_idx = imin[0];
+    out->max = vmax[0];
+    out->max_idx = imax[0];
+    for (size_t j = 1; j < w; j++) {
+        if (vmin[j] < out->min || (vmin[j] == out->min && imin[j] < out->min_idx)) {
+            out->min = vmin[j];
+            out->min_idx = imin[j];
+        }
+        if (vmax[j] > out->max || (vmax[j] == out->max && imax[j] < out->max_idx)) {
+            out->max = vmax[j];
+            out->max_idx = imax[j];
+        }
+    }
+}
+
+static void stats_begin(const float *marks, MarkScanStats *out, double *lane) {
+    memset(out, 0, sizeof *out);
+    memset(lane, 0, SUM_LANES * sizeof *lane);
+    out->min = out->max = marks[0];
+    out->min_idx = out->max_idx = 0;
+}
+
+// Fold marks[start, n) in scalar, then reduce the sum lanes
+static void stats_finish(const float *marks, size_t start, size_t n, double *lane, MarkScanStats *out) {
+    for (size_t i = start; i < n; i++) {
+        float m = marks[i];
+        lane[i % SUM_LANES] += m;
+        if (m < out->min) {
+            out->min = m;
+            out->min_idx = (int)i;
+        }
+        if (m > out->max) {
+            out->max = m;
+            out->max_idx = (int)i;
+        }
+        out->band[band_of(m)]++;
+    }
+    out->sum = reduce_lanes(lane);
+    // Report the stored value so -0.0 and 0.0 cannot differ between kernels
+    out->min = marks[out->min_idx];
+    out->max = marks[out->max_idx];
+}
+
+static void stats_scalar(const float *marks, size_t n, MarkScanStats *out) {
+    double lane[SUM_LANES];
+    stats_begin(marks, out, lane);
+    stats_finish(marks, 0, n, lane, out);
+}
+
+// Append matching slots in [start, n) to out
+static size_t filter_from(const float *marks, size_t start, size_t n, float lo, float hi, int *out) {
+    size_t k = 0;
+    for (size_t i = start; i < n; i++) {
+        if (marks[i] >= lo && marks[i] <= hi) {
+            out[k++] = (int)i;
+        }
+    }
+    return k;
+}
+
+static size_t filter_scalar(const float *marks, size_t n, float lo, float hi, int *out) {
+    return filter_from(marks, 0, n, lo, hi, out);
+}
+
+#ifdef MARKSCAN_X86
+
+__attribute__((target("sse2")))
+static __m128 select_ps_sse2(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+__attribute__((target("sse2")))
+static void stats_sse2(const float *marks, size_t n, MarkScanStats *out) {
+    double lane[SUM_LANES];
+    stats_begin(marks, out, lane);
+    size_t full = n - n % SUM_LANES;
+    if (full) {
+        __m128d acc[8];
+        for (int k = 0; k < 8; k++) acc[k] = _mm_setzero_pd();
+        __m128 vmin = _mm_loadu_ps(marks), vmax = vmin;
+        __m128i imin = _mm_setr_epi32(0, 1, 2, 3), imax = imin, cur = imin;
+        const __m128i step = _mm_set1_epi32(4);
+        const __m128 t[4] = { _mm_set1_ps(GRADE_A_MIN), _mm_set1_ps(GRADE_B_MIN),
+                              _mm_set1_ps(GRADE_C_MIN), _mm_set1_ps(GRADE_D_MIN) };
+        __m128i ge[4] = { _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128() };
+
+        for (size_t i = 0; i < full; i += SUM_LANES) {
+            for (int q = 0; q < 4; q++) {
+                __m128 v = _mm_loadu_ps(marks + i + 4 * q);
+                acc[2 * q] = _mm_add_pd(acc[2 * q], _mm_cvtps_pd(v));
+                acc[2 * q + 1] = _mm_add_pd(acc[2 * q + 1], _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+
+                __m128 lt = _mm_cmplt_ps(v, vmin);
+                vmin = select_ps_sse2(lt, v, vmin);
+                imin = _mm_castps_si128(select_ps_sse2(lt, _mm_castsi128_ps(cur), _mm_castsi128_ps(imin)));
+                __m128 gt = _mm_cmpgt_ps(v, vmax);
+                vmax = select_ps_sse2(gt, v, vmax);
+                imax = _mm_castps_si128(select_ps_sse2(gt, _mm_castsi128_ps(cur), _mm_castsi128_ps(imax)));
+
+                for (int b = 0; b < 4; b++) {
+                    ge[b] = _mm_sub_epi32(ge[b], _mm_castps_si128(_mm_cmpge_ps(v, t[b])));
+                }
+                cur = _mm_add_epi32(cur, step);
+            }
+        }
+
+        for (int k = 0; k < 8; k++) _mm_storeu_pd(lane + 2 * k, acc[k]);
+        float fmin[4], fmax[4];
+        int32_t jmin[4], jmax[4];
+        _mm_storeu_ps(fmin, vmin);
+        _mm_storeu_ps(fmax, vmax);
+        _mm_storeu_si128((__m128i *)jmin, imin);
+        _mm_storeu_si128((__m128i *)jmax, imax);
+        pick_extremes(out, 4, fmin, jmin, fmax, jmax);
+
+        size_t counts[4];
+        for (int b = 0; b < 4; b++) {
+            uint32_t c[4];
+            _mm_storeu_si128((__m128i *)c, ge[b]);
+            counts[b] = (size_t)c[0] + c[1] + c[2] + c[3];
+        }
+        set_bands(out, full, counts);
+    }
+    stats_finish(marks, full, n, lane, out);
+}
+
+__attribute__((target("sse2")))
+static size_t filter_sse2(const float *marks, size_t n, float lo, float hi, int *out) {
+    const __m128 vlo = _mm_set1_ps(lo), vhi = _mm_set1_ps(hi);
+    size_t k = 0, i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 v = _mm_loadu_ps(marks + i);
+        unsigned mask = (unsigned)_mm_movemask_ps(_mm_and_ps(_mm_cmpge_ps(v, vlo), _mm_cmple_ps(v, vhi)));
+        while (mask) {
+            out[k++] = (int)i + __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+    }
+    return k + filter_from(marks, i, n, lo, hi, out + k);
+}
+
+__attribute__((target("avx2")))
+static void stats_avx2(const float *marks, size_t n, MarkScanStats *out) {
+    double lane[SUM_LANES];
+    stats_begin(marks, out, lane);
+    size_t full = n - n % SUM_LANES;
+    if (full) {
+        __m256d acc[4];
+        for (int k = 0; k < 4; k++) acc[k] = _mm256_setzero_pd();
+        __m256 vmin = _mm256_loadu_ps(marks), vmax = vmin;
+        __m256i imin = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), imax = imin, cur = imin;
+        const __m256i step = _mm256_set1_epi32(8);
+        const __m256 t[4] = { _mm256_set1_ps(GRADE_A_MIN), _mm256_set1_ps(GRADE_B_MIN),
+                              _mm256_set1_ps(GRADE_C_MIN), _mm256_set1_ps(GRADE_D_MIN) };
+        __m256i ge[4] = { _mm256_setzero_si256(), _mm256_setzero_si256(),
+                          _mm256_setzero_si256(), _mm256_setzero_si256() };
+
+        for (size_t i = 0; i < full; i += SUM_LANES) {
+            for (int h = 0; h < 2; h++) {
+                __m256 v = _mm256_loadu_ps(marks + i + 8 * h);
+                acc[2 * h] = _mm256_add_pd(acc[2 * h], _mm256_cvtps_pd(_mm256_castps256_ps128(v)));
+                acc[2 * h + 1] = _mm256_add_pd(acc[2 * h + 1], _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)));
+
+                __m256 lt = _mm256_cmp_ps(v, vmin, _CMP_LT_OQ);
+                vmin = _mm256_blendv_ps(vmin, v, lt);
+                imin = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(imin), _mm256_castsi256_ps(cur), lt));
+                __m256 gt = _mm256_cmp_ps(v, vmax, _CMP_GT_OQ);
+                vmax = _mm256_blendv_ps(vmax, v, gt);
+                imax = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(imax), _mm256_castsi256_ps(cur), gt));
+
+                for (int b = 0; b < 4; b++) {
+                    ge[b] = _mm256_sub_epi32(ge[b], _mm256_castps_si256(_mm256_cmp_ps(v, t[b], _CMP_GE_OQ)));
+                }
+                cur = _mm256_add_epi32(cur, step);
+            }
+        }
+
+        for (int k = 0; k < 4; k++) _mm256_storeu_pd(lane + 4 * k, acc[k]);
+        float fmin[8], fmax[8];
+        int32_t jmin[8], jmax[8];
+        _mm256_storeu_ps(fmin, vmin);
+        _mm256_storeu_ps(fmax, vmax);
+        _mm256_storeu_si256((__m256i *)jmin, imin);
+        _mm256_storeu_si256((__m256i *)jmax, imax);
+        pick_extremes(out, 8, fmin, jmin, fmax, jmax);
+
+        size_t counts[4];
+        for (int b = 0; b < 4; b++) {
+            uint32_t c[8];
+            _mm256_storeu_si256((__m256i *)c, ge[b]);
+            counts[b] = 0;
+            for (int j = 0; j < 8; j++) counts[b] += c[j];
+        }
+        set_bands(out, full, counts);
+    }
+    stats_finish(marks, full, n, lane, out);
+}
+
+__attribute__((target("avx2")))
+static size_t filter_avx2(const float *marks, size_t n, float lo, float hi, int *out) {
+    const __m256 vlo = _mm256_set1_ps(lo), vhi = _mm256_set1_ps(hi);
+    size_t k = 0, i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 v = _mm256_loadu_ps(marks + i);
+        __m256 in = _mm256_and_ps(_mm256_cmp_ps(v, vlo, _CMP_GE_OQ), _mm256_cmp_ps(v, vhi, _CMP_LE_OQ));
+        unsigned mask = (unsigned)_mm256_movemask_ps(in);
+        while (mask) {
+            out[k++] = (int)i + __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+    }
+    return k + filter_from(marks, i, n, lo, hi, out + k);
+}
+
+__attribute__((target("avx512f")))
+static void stats_avx512(const float *marks, size_t n, MarkScanStats *out) {
+    double lane[SUM_LANES];
+    stats_begin(marks, out, lane);
+    size_t full = n - n % SUM_LANES;
+    if (full) {
+        __m512d acc_lo = _mm512_setzero_pd(), acc_hi = _mm512_setzero_pd();
+        __m512 vmin = _mm512_loadu_ps(marks), vmax = vmin;
+        __m512i imin = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+        __m512i imax = imin, cur = imin;
+        const __m512i step = _mm512_set1_epi32(16);
+        const __m512 t[4] = { _mm512_set1_ps(GRADE_A_MIN), _mm512_set1_ps(GRADE_B_MIN),
+                              _mm512_set1_ps(GRADE_C_MIN), _mm512_set1_ps(GRADE_D_MIN) };
+        size_t counts[4] = {0};
+
+        for (size_t i = 0; i < full; i += SUM_LANES) {
+            __m512 v = _mm512_loadu_ps(marks + i);
+            __m256 hi = _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(v), 1));
+            acc_lo = _mm512_add_pd(acc_lo, _mm512_cvtps_pd(_mm512_castps512_ps256(v)));
+            acc_hi = _mm512_add_pd(acc_hi, _mm512_cvtps_pd(hi));
+
+            __mmask16 lt = _mm512_cmp_ps_mask(v, vmin, _CMP_LT_OQ);
+            vmin = _mm512_mask_mov_ps(vmin, lt, v);
+            imin = _mm512_mask_mov_epi32(imin, lt, cur);
+            __mmask16 gt = _mm512_cmp_ps_mask(v, vmax, _CMP_GT_OQ);
+            vmax = _mm512_mask_mov_ps(vmax, gt, v);
+            imax = _mm512_mask_mov_epi32(imax, gt, cur);
+
+            for (int b = 0; b < 4; b++) {
+                counts[b] += (size_t)__builtin_popcount(_mm512_cmp_ps_mask(v, t[b], _CMP_GE_OQ));
+            }
+            cur = _mm512_add_epi32(cur, step);
+        }
+
+        _mm512_storeu_pd(lane, acc_lo);
+        _mm512_storeu_pd(lane + 8, acc_hi);
+        float fmin[16], fmax[16];
+        int32_t jmin[16], jmax[16];
+        _mm512_storeu_ps(fmin, vmin);
+        _mm512_storeu_ps(fmax, vmax);
+        _mm512_storeu_si512(jmin, imin);
+        _mm512_storeu_si512(jmax, imax);
+        pick_extremes(out, 16, fmin, jmin, fmax, jmax);
+        set_bands(out, full, counts);
+    }
+    stats_finish(marks, full, n, lane, out);
+}
+
+__attribute__((target("avx512f")))
+static size_t filter_avx512(const float *marks, size_t n, float lo, float hi, int *out) {
+    const __m512 vlo = _mm512_set1_ps(lo), vhi = _mm512_set1_ps(hi);
+    __m512i cur = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m512i step = _mm512_set1_epi32(16);
+    size_t k = 0, i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 v = _mm512_loadu_ps(marks + i);
+        __mmask16 in = _mm512_cmp_ps_mask(v, vlo, _CMP_GE_OQ) & _mm512_cmp_ps_mask(v, vhi, _CMP_LE_OQ);
+        _mm512_mask_compressstoreu_epi32(out + k, in, cur);
+        k += (size_t)__builtin_popcount(in);
+        cur = _mm512_add_epi32(cur, step);
+    }
+    return k + filter_from(marks, i, n, lo, hi, out + k);
+}
+
+#endif // MARKSCAN_X86
+
+static const MarkScanOps kernel_ops[MARKSCAN_KERNELS] = {
+    [MARKSCAN_SCALAR] = { stats_scalar, filter_scalar },
+#ifdef MARKSCAN_X86
+    [MARKSCAN_SSE2] = { stats_sse2, filter_sse2 },
+    [MARKSCAN_AVX2] = { stats_avx2, filter_avx2 },
+    [MARKSCAN_AVX512] = { stats_avx512, filter_avx512 },
+#else
+    [MARKSCAN_SSE2] = { stats_scalar, filter_scalar },
+    [MARKSCAN_AVX2] = { stats_scalar, filter_scalar },
+    [MARKSCAN_AVX512] = { stats_scalar, filter_scalar },
+#endif
+};
+
+static const char *const kernel_names[MARKSCAN_KERNELS] = {
+    "scalar", "sse2", "avx2", "avx512"
+};
+
+static MarkScanKernel g_kernel;
+static pthread_once_t g_kernel_once = PTHREAD_ONCE_INIT;
+
+static void kernel_pick(void) {
+    g_kernel = markscan_best();
+}
+
+bool markscan_supported(MarkScanKernel k) {
+    switch (k) {
+    case MARKSCAN_SCALAR:
+        return true;
+#ifdef MARKSCAN_X86
+    case MARKSCAN_SSE2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse2");
+    case MARKSCAN_AVX2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+    case MARKSCAN_AVX512:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx512f");
+#endif
+    default:
+        return false;
+    }
+}
+
+MarkScanKernel markscan_best(void) {
+    for (int k = MARKSCAN_KERNELS - 1; k > MARKSCAN_SCALAR; k--) {
+        if (markscan_supported((MarkScanKernel)k)) {
+            return (MarkScanKernel)k;
+        }
+    }
+    return MARKSCAN_SCALAR;
+}
+
+MarkScanKernel markscan_active(void) {
+    pthread_once(&g_kernel_once, kernel_pick);
+    return g_kernel;
+}
+
+bool markscan_select(MarkScanKernel k) {
+    pthread_once(&g_kernel_once, kernel_pick);
+    if (k >= MARKSCAN_KERNELS || !markscan_supported(k)) {
+        return false;
+    }
+    g_kernel = k;
+    return true;
+}
+
+const char *markscan_kernel_name(MarkScanKernel k) {
+    return k < MARKSCAN_KERNELS ? kernel_names[k] : "unknown";
+}
+
+void markscan_stats(const float *marks, size_t n, MarkScanStats *out) {
+    if (n == 0) {
+        memset(out, 0, sizeof *out);
+        out->min_idx = out->max_idx = -1;
+        return;
+    }
+    kernel_ops[markscan_active()].stats(marks, n, out);
+}
+
+// Adjacent representable floats, to turn strict bounds into inclusive ones
+static float float_next_up(float x) {
+    if (isnan(x) || x == INFINITY) return x;
+    if (x == 0.0f) return FLT_TRUE_MIN;
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof bits);
+    if (x > 0.0f) bits++;
+    else bits--;
+    memcpy(&x, &bits, sizeof x);
+    return x;
+}
+
+static float float_next_down(float x) {
+    return -float_next_up(-x);
+}
+
+void markscan_bounds(MarkRange r, float *lo, float *hi) {
+    *lo = r.lo_incl ? r.lo : float_next_up(r.lo);
+    *hi = r.hi_incl ? r.hi : float_next_down(r.hi);
+}
+
+size_t markscan_filter(const float *marks, size_t n, MarkRange r, int *out) {
+    float lo, hi;
+    markscan_bounds(r, &lo, &hi);
+    return kernel_ops[markscan_active()].filter(marks, n, lo, hi, out);
+}
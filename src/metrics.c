@@ -0,0 +1,229 @@
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+#include "metrics.h"
+
+// Log-linear buckets: below HIST_SUB ns one bucket per value, then HIST_SUB
+// buckets per power of two, so a reported percentile is within 1/HIST_SUB
+// (12.5%) of the true value. Times of 2^HIST_MAX_EXP ns (about 18 minutes)
+// and up share the last bucket.
+#define HIST_SUB_BITS 3
+#define HIST_SUB (1u << HIST_SUB_BITS)
+#define HIST_MAX_EXP 40
+#define HIST_BUCKETS ((HIST_MAX_EXP - HIST_SUB_BITS + 1) * HIST_SUB)
+
+typedef struct {
+    atomic_uint_fast64_t count;
+    atomic_uint_fast64_t total_ns;
+    atomic_uint_fast64_t max_ns;
+    atomic_uint_fast64_t buckets[HIST_BUCKETS];
+} Histogram;
+
+// Commands with their own histogram; anything else is counted as "other"
+static const char *const COMMANDS[] = {
+    "open", "save", "compact", "convert", "show", "insert", "import", "update",
+    "delete", "query", "find", "help", "metrics", "exit", "quit", "other",
+};
+#define N_COMMANDS (sizeof COMMANDS / sizeof *COMMANDS)
+
+atomic_uint_fast64_t metrics_counters[METRIC_COUNTERS];
+static Histogram g_hist[N_COMMANDS];
+static atomic_uint_fast64_t g_since_ns;    // Start of the reporting period, 0 = first record
+
+static const char *const COUNTER_NAMES[METRIC_COUNTERS] = {
+    [METRIC_ROWS_SCANNED] = "rows_scanned",
+    [METRIC_ROWS_MATCHED] = "rows_matched",
+    [METRIC_ROWS_SORTED] = "rows_sorted",
+    [METRIC_GROW_REALLOCS] = "grow_reallocs",
+    [METRIC_GROW_BYTES] = "grow_bytes_moved",
+    [METRIC_BYTES_READ] = "bytes_read",
+    [METRIC_BYTES_WRITTEN] = "bytes_written",
+};
+
+const char *metrics_counter_name(MetricCounter c) {
+    return c < METRIC_COUNTERS ? COUNTER_NAMES[c] : "unknown";
+}
+
+uint64_t metrics_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static size_t bucket_of(uint64_t ns) {
+    if (ns < HIST_SUB) {
+        return (size_t)ns;
+    }
+    unsigned e = 63u - (unsigned)__builtin_clzll(ns);
+    size_t b = (size_t)(e - HIST_SUB_BITS + 1) * HIST_SUB + (size_t)((ns >> (e - HIST_SUB_BITS)) & (HIST_SUB - 1));
+    return b < HIST_BUCKETS ? b : HIST_BUCKETS - 1;
+}
+
+// Largest value that falls in bucket b
+static uint64_t bucket_high(size_t b) {
+    if (b < HIST_SUB) {
+        return b;
+    }
+    unsigned e = (unsigned)(b / HIST_SUB) + HIST_SUB_BITS - 1;
+    uint64_t step = (uint64_t)1 << (e - HIST_SUB_BITS);
+    return ((uint64_t)(HIST_SUB + b % HIST_SUB) << (e - HIST_SUB_BITS)) + step - 1;
+}
+
+static size_t command_slot(const char *cmd) {
+    for (size_t i = 0; i + 1 < N_COMMANDS; i++) {
+        if (strcmp(cmd, COMMANDS[i]) == 0) return i;
+    }
+    return N_COMMANDS - 1;
+}
+
+void metrics_record(const char *cmd, uint64_t ns) {
+    Histogram *h = &g_hist[command_slot(cmd)];
+    atomic_fetch_add_explicit(&h->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->total_ns, ns, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->buckets[bucket_of(ns)], 1, memory_order_relaxed);
+    uint_fast64_t max = atomic_load_explicit(&h->max_ns, memory_order_relaxed);
+    while (ns > max && !atomic_compare_exchange_weak_explicit(&h->max_ns, &max, ns,
+                                                              memory_order_relaxed, memory_order_relaxed)) {
+    }
+    uint_fast64_t zero = 0;
+    atomic_compare_exchange_strong_explicit(&g_since_ns, &zero, metrics_now_ns() - ns,
+                                            memory_order_relaxed, memory_order_relaxed);
+}
+
+// Upper bound of the bucket holding the q-th fraction of samples, capped at
+// the largest time seen. Buckets may move while this reads them; the answer
+// is then off by the few samples recorded meanwhile.
+static uint64_t percentile(const Histogram *h, uint64_t count, uint64_t max, double q) {
+    uint64_t rank = (uint64_t)(q * (double)count + 0.5);
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (size_t b = 0; b < HIST_BUCKETS; b++) {
+        seen += atomic_load_explicit(&h->buckets[b], memory_order_relaxed);
+        if (seen >= rank) {
+            uint64_t high = bucket_high(b);
+            return high < max ? high : max;
+        }
+    }
+    return max;
+}
+
+void metrics_report(FILE *out) {
+    uint64_t since = atomic_load_explicit(&g_since_ns, memory_order_relaxed);
+    double period = since ? (double)(metrics_now_ns() - since) / 1e9 : 0.0;
+    fprintf(out, "Command latency over %.1f s (microseconds):\n", period);
+    fprintf(out, "%-10s %10s %12s %12s %12s %12s\n", "Command", "Count", "p50", "p99", "Max", "Mean");
+    for (size_t i = 0; i < N_COMMANDS; i++) {
+        const Histogram *h = &g_hist[i];
+        uint64_t count = atomic_load_explicit(&h->count, memory_order_relaxed);
+        if (count == 0) continue;
+        uint64_t max = atomic_load_explicit(&h->max_ns, memory_order_relaxed);
+        uint64_t total = atomic_load_explicit(&h->total_ns, memory_order_relaxed);
+        fprintf(out, "%-10s %10llu %12.1f %12.1f %12.1f %12.1f\n", COMMANDS[i], (unsigned long long)count,
+                (double)percentile(h, count, max, 0.50) / 1e3, (double)percentile(h, count, max, 0.99) / 1e3,
+                (double)max / 1e3, (double)total / (double)count / 1e3);
+    }
+    fputs("Counters:\n", out);
+    for (size_t c = 0; c < METRIC_COUNTERS; c++) {
+        fprintf(out, "  %-18s %llu\n", COUNTER_NAMES[c],
+                (unsigned long long)atomic_load_explicit(&metrics_counters[c], memory_order_relaxed));
+    }
+}
+
+void metrics_reset(void) {
+    for (size_t i = 0; i < N_COMMANDS; i++) {
+        Histogram *h = &g_hist[i];
+        atomic_store_explicit(&h->count, 0, memory_order_relaxed);
+        atomic_store_explicit(&h->total_ns, 0, memory_order_relaxed);
+        atomic_store_explicit(&h->max_ns, 0, memory_order_relaxed);
+        for (size_t b = 0; b < HIST_BUCKETS; b++) {
+            atomic_store_explicit(&h->buckets[b], 0, memory_order_relaxed);
+        }
+    }
+    for (size_t c = 0; c < METRIC_COUNTERS; c++) {
+        atomic_store_explicit(&metrics_counters[c], 0, memory_order_relaxed);
+    }
+    atomic_store_explicit(&g_since_ns, metrics_now_ns(), memory_order_relaxed);
+}
+
+// ---- Periodic dump ----
+
+static struct {
+    pthread_mutex_t mu;
+    pthread_cond_t cv;
+    pthread_t thread;
+    bool running;
+    bool stop;
+    FILE *fp;
+    unsigned interval_sec;
+} g_dump = { .mu = PTHREAD_MUTEX_INITIALIZER };
+
+static void dump_once(FILE *fp) {
+    char stamp[32];
+    time_t now = time(NULL);
+    struct tm tm;
+    strftime(stamp, sizeof stamp, "%Y-%m-%dT%H:%M:%S", localtime_r(&now, &tm));
+    fprintf(fp, "# CMS metrics at %s\n", stamp);
+    metrics_report(fp);
+    fputc('\n', fp);
+    fflush(fp);
+}
+
+static void *dump_main(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&g_dump.mu);
+    while (!g_dump.stop) {
+        struct timespec until;
+        clock_gettime(CLOCK_MONOTONIC, &until);
+        until.tv_sec += g_dump.interval_sec;
+        while (!g_dump.stop && pthread_cond_timedwait(&g_dump.cv, &g_dump.mu, &until) == 0) {
+        }
+        dump_once(g_dump.fp);
+    }
+    pthread_mutex_unlock(&g_dump.mu);
+    return NULL;
+}
+
+bool metrics_dump_start(const char *path, unsigned interval_sec) {
+    FILE *fp = fopen(path, "a");
+    if (!fp) {
+        return false;
+    }
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&g_dump.cv, &attr);
+    pthread_condattr_destroy(&attr);
+
+    g_dump.fp = fp;
+    g_dump.interval_sec = interval_sec ? interval_sec : 1;
+    g_dump.stop = false;
+
+    // Leave signals to the threads that handle them, such as the server loop
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+    int rc = pthread_create(&g_dump.thread, NULL, dump_main, NULL);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (rc != 0) {
+        pthread_cond_destroy(&g_dump.cv);
+        fclose(fp);
+        return false;
+    }
+    g_dump.running = true;
+    return true;
+}
+
+void metrics_dump_stop(void) {
+    if (!g_dump.running) {
+        return;
+    }
+    pthread_mutex_lock(&g_dump.mu);
+    g_dump.stop = true;
+    pthread_cond_signal(&g_dump.cv);
+    pthread_mutex_unlock(&g_dump.mu);
+    pthread_join(g_dump.thread, NULL);
+    pthread_cond_destroy(&g_dump.cv);
+    fclose(g_dump.fp);
+    g_dump.running = false;
+}
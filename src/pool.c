@@ -0,0 +1,114 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "pool.h"
+
+typedef struct {
+    pthread_mutex_t mu;
+    pthread_cond_t work_cv;     // Workers wait here for the next job
+    pthread_cond_t done_cv;     // The caller waits here for workers to finish
+    pthread_mutex_t run_mu;     // One job at a time
+    pthread_once_t once;
+    size_t workers;
+    uint64_t job;               // Bumped for every job handed out
+    PoolFn fn;
+    void *ctx;
+    size_t n;
+    size_t parts;
+    size_t pending;             // Workers still on the current job
+} Pool;
+
+static Pool g_pool = {
+    .mu = PTHREAD_MUTEX_INITIALIZER,
+    .work_cv = PTHREAD_COND_INITIALIZER,
+    .done_cv = PTHREAD_COND_INITIALIZER,
+    .run_mu = PTHREAD_MUTEX_INITIALIZER,
+    .once = PTHREAD_ONCE_INIT,
+};
+
+static size_t part_begin(size_t n, size_t parts, size_t part) {
+    return (size_t)((unsigned __int128)n * part / parts);
+}
+
+static void *worker_main(void *arg) {
+    size_t part = (size_t)(uintptr_t)arg;
+    uint64_t seen = 0;
+    for (;;) {
+        pthread_mutex_lock(&g_pool.mu);
+        while (g_pool.job == seen) {
+            pthread_cond_wait(&g_pool.work_cv, &g_pool.mu);
+        }
+        seen = g_pool.job;
+        PoolFn fn = g_pool.fn;
+        void *ctx = g_pool.ctx;
+        size_t n = g_pool.n, parts = g_pool.parts;
+        pthread_mutex_unlock(&g_pool.mu);
+
+        if (part < parts) {
+            fn(ctx, part, part_begin(n, parts, part), part_begin(n, parts, part + 1));
+        }
+
+        pthread_mutex_lock(&g_pool.mu);
+        if (--g_pool.pending == 0) {
+            pthread_cond_signal(&g_pool.done_cv);
+        }
+        pthread_mutex_unlock(&g_pool.mu);
+    }
+    return NULL;
+}
+
+static void pool_start(void) {
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    const char *env = getenv("CMS_THREADS");
+    if (env && atol(env) > 0) threads = atol(env);
+    if (threads < 1) threads = 1;
+    if (threads > POOL_MAX_PARTS) threads = POOL_MAX_PARTS;
+
+    for (long i = 1; i < threads; i++) {
+        pthread_t tid;
+        if (pthread_create(&tid, NULL, worker_main, (void *)(uintptr_t)i) != 0) {
+            break; // Run with the workers we have
+        }
+        pthread_detach(tid);
+        g_pool.workers++;
+    }
+}
+
+size_t pool_threads(void) {
+    pthread_once(&g_pool.once, pool_start);
+    return g_pool.workers + 1;
+}
+
+size_t pool_run(size_t n, size_t min_per_part, PoolFn fn, void *ctx) {
+    size_t parts = pool_threads();
+    if (min_per_part && n / min_per_part < parts) {
+        parts = n / min_per_part;
+    }
+    if (parts <= 1) {
+        fn(ctx, 0, 0, n);
+        return 1;
+    }
+
+    pthread_mutex_lock(&g_pool.run_mu);
+    pthread_mutex_lock(&g_pool.mu);
+    g_pool.fn = fn;
+    g_pool.ctx = ctx;
+    g_pool.n = n;
+    g_pool.parts = parts;
+    g_pool.pending = g_pool.workers;
+    g_pool.job++;
+    pthread_cond_broadcast(&g_pool.work_cv);
+    pthread_mutex_unlock(&g_pool.mu);
+
+    fn(ctx, 0, 0, part_begin(n, parts, 1));
+
+    pthread_mutex_lock(&g_pool.mu);
+    while (g_pool.pending > 0) {
+        pthread_cond_wait(&g_pool.done_cv, &g_pool.mu);
+    }
+    pthread_mutex_unlock(&g_pool.mu);
+    pthread_mutex_unlock(&g_pool.run_mu);
+    return parts;
+}
@@ -0,0 +1,119 @@
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "metrics.h"
+#include "profile.h"
+
+static const struct {
+    uint32_t type;
+    uint64_t config;
+    const char *name;
+} EVENTS[PROFILE_EVENTS] = {
+    [PROFILE_CYCLES]        = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES,     "cycles" },
+    [PROFILE_INSTRUCTIONS]  = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS,   "instructions" },
+    [PROFILE_CACHE_MISSES]  = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES,   "cache-misses" },
+    [PROFILE_BRANCH_MISSES] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES,  "branch-misses" },
+    [PROFILE_PAGE_FAULTS]   = { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS,    "page-faults" },
+};
+
+const char *profile_event_name(ProfileEvent e) {
+    return e < PROFILE_EVENTS ? EVENTS[e].name : "unknown";
+}
+
+// User-space counts only, which perf_event_paranoid 2 (the common default)
+// still allows for a process's own threads
+static int event_open(ProfileEvent e, pid_t tid) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof attr);
+    attr.size = sizeof attr;
+    attr.type = EVENTS[e].type;
+    attr.config = EVENTS[e].config;
+    attr.disabled = 1;
+    attr.inherit = 1;           // Threads this one starts are counted too
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attr, tid, -1, -1, 0);
+}
+
+// Thread IDs of this process, from /proc/self/task
+static size_t list_threads(pid_t *tids, size_t max) {
+    DIR *dir = opendir("/proc/self/task");
+    if (!dir) {
+        tids[0] = 0;     // Calling thread only
+        return 1;
+    }
+    size_t n = 0;
+    struct dirent *de;
+    while (n < max && (de = readdir(dir))) {
+        if (de->d_name[0] != '.') tids[n++] = (pid_t)atoi(de->d_name);
+    }
+    closedir(dir);
+    return n;
+}
+
+void profile_begin(ProfileSession *p) {
+    pid_t tids[PROFILE_MAX_THREADS];
+    p->threads = list_threads(tids, PROFILE_MAX_THREADS);
+    p->open_errno = 0;
+    bool usable[PROFILE_EVENTS];
+    for (size_t e = 0; e < PROFILE_EVENTS; e++) usable[e] = true;
+
+    for (size_t t = 0; t < p->threads; t++) {
+        for (size_t e = 0; e < PROFILE_EVENTS; e++) {
+            p->fd[t][e] = usable[e] ? event_open((ProfileEvent)e, tids[t]) : -1;
+            // An event the kernel refuses once will be refused for every thread;
+            // a thread that exited meanwhile (ESRCH) is simply skipped
+            if (p->fd[t][e] < 0 && usable[e] && errno != ESRCH) {
+                if (!p->open_errno) p->open_errno = errno;
+                usable[e] = false;
+            }
+        }
+    }
+    for (size_t t = 0; t < p->threads; t++) {
+        for (size_t e = 0; e < PROFILE_EVENTS; e++) {
+            if (p->fd[t][e] >= 0) ioctl(p->fd[t][e], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+    p->t0_ns = metrics_now_ns();
+}
+
+void profile_end(ProfileSession *p, ProfileResult *r) {
+    r->seconds = (double)(metrics_now_ns() - p->t0_ns) / 1e9;
+    r->open_errno = p->open_errno;
+    for (size_t e = 0; e < PROFILE_EVENTS; e++) {
+        r->valid[e] = false;
+        r->scaled[e] = false;
+        r->value[e] = 0;
+    }
+
+    for (size_t t = 0; t < p->threads; t++) {
+        for (size_t e = 0; e < PROFILE_EVENTS; e++) {
+            if (p->fd[t][e] >= 0) ioctl(p->fd[t][e], PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+    for (size_t t = 0; t < p->threads; t++) {
+        for (size_t e = 0; e < PROFILE_EVENTS; e++) {
+            int fd = p->fd[t][e];
+            if (fd < 0) continue;
+            uint64_t buf[3];    // value, time enabled, time running
+            if (read(fd, buf, sizeof buf) == (ssize_t)sizeof buf) {
+                uint64_t v = buf[0];
+                // Multiplexed with other events: extrapolate over the whole window
+                if (buf[2] > 0 && buf[2] < buf[1]) {
+                    v = (uint64_t)((double)v * (double)buf[1] / (double)buf[2]);
+                    r->scaled[e] = true;
+                }
+                if (buf[2] > 0 || buf[1] == 0) r->valid[e] = true;
+                r->value[e] += v;
+            }
+            close(fd);
+        }
+    }
+}
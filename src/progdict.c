@@ -0,0 +1,106 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "progdict.h"
+
+#define BLOCK_BITS 8
+#define BLOCK_SIZE (1u << BLOCK_BITS)
+#define TEXT_MAX 64
+
+// Names live in fixed blocks that never move, so prog_name needs no lock
+static char (*blocks[(PROG_MAX_CODES + 1) / BLOCK_SIZE + 1])[TEXT_MAX];
+static size_t count;
+
+// Open-addressing table of codes keyed by name, guarded by lock
+static ProgCode *table;
+static size_t table_cap;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+static size_t hash_text(const char *text, size_t len) {
+    size_t h = 1469598103934665603ull; // FNV-1a
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)text[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+static char *slot_text(ProgCode code) {
+    return blocks[code >> BLOCK_BITS][code & (BLOCK_SIZE - 1)];
+}
+
+static size_t probe(const char *text, size_t len) {
+    size_t mask = table_cap - 1;
+    size_t pos = hash_text(text, len) & mask;
+    while (table[pos] != PROG_NONE) {
+        const char *cur = slot_text(table[pos]);
+        if (strncmp(cur, text, len) == 0 && cur[len] == '\0') break;
+        pos = (pos + 1) & mask;
+    }
+    return pos;
+}
+
+static int grow_table(void) {
+    size_t new_cap = table_cap ? table_cap * 2 : 64;
+    ProgCode *old = table;
+    size_t old_cap = table_cap;
+    table = calloc(new_cap, sizeof *table);
+    if (!table) {
+        table = old;
+        return 0;
+    }
+    table_cap = new_cap;
+    for (size_t i = 0; i < old_cap; i++) {
+        if (old[i] == PROG_NONE) continue;
+        const char *text = slot_text(old[i]);
+        table[probe(text, strlen(text))] = old[i];
+    }
+    free(old);
+    return 1;
+}
+
+ProgCode prog_intern_len(const char *text, size_t len) {
+    if (len > TEXT_MAX - 1) len = TEXT_MAX - 1;
+    if (len == 0) return PROG_NONE;
+
+    pthread_mutex_lock(&lock);
+    ProgCode code = PROG_NONE;
+    if ((count + 1) * 2 > table_cap && !grow_table()) goto done;
+
+    size_t pos = probe(text, len);
+    if (table[pos] != PROG_NONE) {
+        code = table[pos];
+        goto done;
+    }
+    if (count == PROG_MAX_CODES) goto done;
+
+    ProgCode next = (ProgCode)(count + 1);
+    if (!blocks[next >> BLOCK_BITS]) {
+        blocks[next >> BLOCK_BITS] = calloc(BLOCK_SIZE, TEXT_MAX);
+        if (!blocks[next >> BLOCK_BITS]) goto done;
+    }
+    memcpy(slot_text(next), text, len);
+    slot_text(next)[len] = '\0';
+    table[pos] = next;
+    count++;
+    code = next;
+
+done:
+    pthread_mutex_unlock(&lock);
+    return code;
+}
+
+ProgCode prog_intern(const char *text) {
+    return prog_intern_len(text, strlen(text));
+}
+
+const char *prog_name(ProgCode code) {
+    return code == PROG_NONE ? "" : slot_text(code);
+}
+
+size_t prog_count(void) {
+    pthread_mutex_lock(&lock);
+    size_t n = count;
+    pthread_mutex_unlock(&lock);
+    return n;
+}
@@ -0,0 +1,123 @@
+#include <string.h>
+#include "render.h"
+#include "util.h"
+
+#define RENDER_BUF_SIZE (64 * 1024)
+#define ROW_MAX 256   // Longest formatted row, with room to spare
+
+typedef struct {
+    FILE *out;
+    char buf[RENDER_BUF_SIZE];
+    size_t len;
+} RenderBuf;
+
+static void rb_flush(RenderBuf *rb) {
+    fwrite(rb->buf, 1, rb->len, rb->out);
+    rb->len = 0;
+}
+
+static void rb_cell(RenderBuf *rb, const char *text, size_t len, size_t width, bool right) {
+    size_t pad = width > len ? width - len : 0;
+    if (right) {
+        memset(rb->buf + rb->len, ' ', pad);
+        rb->len += pad;
+    }
+    memcpy(rb->buf + rb->len, text, len);
+    rb->len += len;
+    if (!right) {
+        memset(rb->buf + rb->len, ' ', pad);
+        rb->len += pad;
+    }
+}
+
+static size_t max_size(size_t a, size_t b) {
+    return a > b ? a : b;
+}
+
+typedef struct {
+    size_t id, name, prog, mark;
+} ColWidths;
+
+// Print the size line and column headings; false if there are no rows
+static bool render_header(FILE *out, size_t size, size_t cap, const StoreWidths *widths, ColWidths *w) {
+    if (size == 0) {
+        fputs("No records.\n", out);
+        return false;
+    }
+
+    w->id = max_size(strlen("ID"), store_width(widths->id));
+    w->name = max_size(strlen("Name"), store_width(widths->name));
+    w->prog = max_size(strlen("Programme"), store_width(widths->prog));
+    w->mark = max_size(strlen("Mark"), store_width(widths->mark));
+
+    fprintf(out, "size=%zu cap=%zu\n", size, cap);
+    fprintf(out, "%-*s  %-*s  %-*s  %*s\n", (int)w->id, "ID", (int)w->name, "Name",
+            (int)w->prog, "Programme", (int)w->mark, "Mark");
+    return true;
+}
+
+static void rb_row(RenderBuf *rb, const ColWidths *w, int id, const char *name, ProgCode code, float mark) {
+    char cell[24];
+    const char *prog = prog_name(code);
+    rb_cell(rb, cell, fmt_int(cell, id), w->id, true);
+    rb_cell(rb, "  ", 2, 0, false);
+    rb_cell(rb, name, strlen(name), w->name, false);
+    rb_cell(rb, "  ", 2, 0, false);
+    rb_cell(rb, prog, strlen(prog), w->prog, false);
+    rb_cell(rb, "  ", 2, 0, false);
+    rb_cell(rb, cell, fmt_mark(cell, mark), w->mark, true);
+    rb->buf[rb->len++] = '\n';
+    if (rb->len > RENDER_BUF_SIZE - ROW_MAX) {
+        rb_flush(rb);
+    }
+}
+
+static void render_footer(FILE *out, size_t size, size_t offset, size_t first, size_t end) {
+    if (first == end) {
+        fprintf(out, "No rows at offset %zu of %zu\n", offset, size);
+    } else if (first > 0 || end < size) {
+        fprintf(out, "Rows %zu-%zu of %zu\n", first + 1, end, size);
+    }
+    fputc('\n', out);
+}
+
+void render_table(FILE *out, const Store *s, const SortView *view, size_t offset, size_t limit) {
+    ColWidths w;
+    if (!render_header(out, s->size, s->cap, &s->widths, &w)) {
+        return;
+    }
+
+    size_t first = offset < s->size ? offset : s->size;
+    size_t end = limit < s->size - first ? first + limit : s->size;
+
+    RenderBuf rb;
+    rb.out = out;
+    rb.len = 0;
+    for (size_t i = first; i < end; i++) {
+        size_t slot = view ? (size_t)store_find_index_by_id(s, view->rows[i].id) : i;
+        rb_row(&rb, &w, s->ids[slot], store_name(s, slot), s->progs[slot], s->marks[slot]);
+    }
+    rb_flush(&rb);
+    render_footer(out, s->size, offset, first, end);
+}
+
+void render_version(FILE *out, const StoreVersion *v, size_t offset, size_t limit) {
+    ColWidths w;
+    if (!render_header(out, v->size, v->cap, &v->widths, &w)) {
+        return;
+    }
+
+    size_t first = offset < v->size ? offset : v->size;
+    size_t end = limit < v->size - first ? first + limit : v->size;
+
+    RenderBuf rb;
+    rb.out = out;
+    rb.len = 0;
+    for (size_t i = first; i < end; i++) {
+        const VersionChunk *c = version_chunk(v, i);
+        size_t r = i % STORE_BLOCK_ROWS;
+        rb_row(&rb, &w, c->ids[r], c->names + c->name_off[r], c->progs[r], c->marks[r]);
+    }
+    rb_flush(&rb);
+    render_footer(out, v->size, offset, first, end);
+}
@@ -0,0 +1,95 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "io.h"
+#include "journal.h"
+#include "saver.h"
+
+typedef struct {
+    char path[512];
+    Store copy;
+    bool reset_journal;
+    FILE *report;
+    SaveResult result;
+} SaveJob;
+
+// Callers serialize saver_start and saver_wait (one console thread, or the
+// server's exclusive store lock), so only g_running needs to be atomic
+static pthread_t g_thread;
+static bool g_started = false;   // g_thread has not been joined yet
+static SaveJob g_job;
+static atomic_bool g_running;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void *save_main(void *arg) {
+    SaveJob *job = arg;
+    double t0 = now_sec();
+    job->result.ok = cms_save(job->path, &job->copy);
+    if (job->result.ok && job->reset_journal) {
+        // The new file holds every journaled change, so replaying them is no
+        // longer needed
+        Journal j;
+        journal_init(&j, job->path);
+        if (!journal_truncate(&j) && job->report) {
+            fprintf(job->report, "Warning: failed to reset journal %s\n", j.path);
+        }
+        journal_free(&j);
+    }
+    job->result.seconds = now_sec() - t0;
+    store_free(&job->copy);
+
+    if (job->report) {
+        if (job->result.ok) {
+            fprintf(job->report, "Database saved to %s (%zu record(s) in %.2f s)\n",
+                    job->path, job->result.rows, job->result.seconds);
+        } else {
+            fprintf(job->report, "Failed to save database to %s\n", job->path);
+        }
+        fflush(job->report);
+    }
+    atomic_store(&g_running, false);
+    return NULL;
+}
+
+bool saver_start(const char *path, Store *copy, uint64_t generation, bool reset_journal, FILE *report) {
+    saver_wait(NULL);
+    if (strlen(path) >= sizeof g_job.path) {
+        store_free(copy);
+        return false;
+    }
+    strcpy(g_job.path, path);
+    g_job.copy = *copy;
+    g_job.reset_journal = reset_journal;
+    g_job.report = report;
+    g_job.result = (SaveResult){ .generation = generation, .rows = copy->size };
+
+    atomic_store(&g_running, true);
+    if (pthread_create(&g_thread, NULL, save_main, &g_job) != 0) {
+        atomic_store(&g_running, false);
+        store_free(&g_job.copy);
+        return false;
+    }
+    g_started = true;
+    return true;
+}
+
+bool saver_wait(SaveResult *r) {
+    if (!g_started) {
+        return false;
+    }
+    pthread_join(g_thread, NULL);
+    g_started = false;
+    if (r) *r = g_job.result;
+    return true;
+}
+
+bool saver_busy(void) {
+    return atomic_load(&g_running);
+}
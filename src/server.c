@@ -0,0 +1,477 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "cmd.h"
+#include "server.h"
+
+#define SERVER_BACKLOG 64
+#define SERVER_EVENTS 64
+#define SERVER_MAX_WORKERS 16
+#define CLIENT_LINE_MAX 512      // Same limit as the console's line buffer
+#define CLIENT_READ_CHUNK 4096
+
+typedef struct Client Client;
+struct Client {
+    int fd;
+    char *in;                    // Received bytes not yet run
+    size_t in_len, in_cap;
+    char *out;                   // Output not yet sent
+    size_t out_len, out_off, out_cap;
+    char line[CLIENT_LINE_MAX];  // Command a worker is running
+    char *result;                // Worker output, handed back under mu
+    size_t result_len;
+    bool busy;                   // A worker owns line and result
+    bool eof;                    // Peer closed its side; finish what was sent
+    bool quit;                   // EXIT or a dead socket: drop further input
+    bool want_write;             // Output is waiting for EPOLLOUT
+    bool detached;               // Peer hung up; no longer in the epoll set
+    bool closing;                // Settled; freed once the current event batch is done
+    uint32_t events;             // Current epoll registration
+    Client *next;                // Job or done queue link
+    Client *all_prev, *all_next; // Every open client, for shutdown
+    Client *dead_next;           // Closing clients waiting to be freed
+};
+
+typedef struct {
+    Store *s;
+    const char *db_path;
+    SharedStore shared;          // Store lock and versions for long reads
+    pthread_mutex_t mu;          // Guards the queues and each client's busy/result
+    pthread_cond_t job_cv;
+    Client *jobs_head, *jobs_tail;
+    Client *done;
+    bool stopping;
+    int epfd;
+    int wake_fd;                 // eventfd: a worker finished a command
+    Client *all;
+    Client *dead;                // Freed after the epoll batch that closed them
+} Server;
+
+// Marker epoll data for the non-client descriptors
+static char g_listen_tag, g_wake_tag, g_signal_tag;
+
+static void *worker_main(void *arg) {
+    Server *sv = arg;
+    for (;;) {
+        pthread_mutex_lock(&sv->mu);
+        while (!sv->jobs_head && !sv->stopping) {
+            pthread_cond_wait(&sv->job_cv, &sv->mu);
+        }
+        Client *c = sv->jobs_head;
+        if (!c) {
+            pthread_mutex_unlock(&sv->mu);
+            break;
+        }
+        sv->jobs_head = c->next;
+        if (!sv->jobs_head) sv->jobs_tail = NULL;
+        pthread_mutex_unlock(&sv->mu);
+
+        char *buf = NULL;
+        size_t len = 0;
+        FILE *mem = open_memstream(&buf, &len);
+        if (mem) {
+            CmdContext ctx = { .out = mem, .err = mem, .batch = true, .shared = &sv->shared };
+            cmd_execute(&ctx, c->line, sv->s, sv->db_path);
+            fputs(SERVER_END, mem);
+            if (fclose(mem) != 0) {
+                free(buf);
+                buf = NULL;
+            }
+        }
+
+        pthread_mutex_lock(&sv->mu);
+        c->result = buf;
+        c->result_len = buf ? len : 0;
+        c->next = sv->done;
+        sv->done = c;
+        pthread_mutex_unlock(&sv->mu);
+
+        uint64_t one = 1;
+        ssize_t w = write(sv->wake_fd, &one, sizeof one);
+        (void)w; // The counter cannot overflow at one write per command
+    }
+    return NULL;
+}
+
+static bool buf_append(char **buf, size_t *len, size_t *cap, const char *data, size_t n) {
+    if (*len + n > *cap) {
+        size_t new_cap = *cap ? *cap : CLIENT_READ_CHUNK;
+        while (new_cap < *len + n) new_cap *= 2;
+        char *grown = realloc(*buf, new_cap);
+        if (!grown) return false;
+        *buf = grown;
+        *cap = new_cap;
+    }
+    memcpy(*buf + *len, data, n);
+    *len += n;
+    return true;
+}
+
+static void client_send(Client *c, const char *text) {
+    if (!buf_append(&c->out, &c->out_len, &c->out_cap, text, strlen(text))) {
+        c->quit = true;
+    }
+}
+
+// Poll for input until the peer closes its side, and for output while some is queued
+static void set_want_write(Server *sv, Client *c, bool want) {
+    c->want_write = want;
+    uint32_t events = (c->eof ? 0 : EPOLLIN) | (want ? EPOLLOUT : 0);
+    if (c->detached || events == c->events) return;
+    struct epoll_event ev = { .events = events, .data.ptr = c };
+    epoll_ctl(sv->epfd, EPOLL_CTL_MOD, c->fd, &ev);
+    c->events = events;
+}
+
+// Send queued output without blocking; the rest waits for EPOLLOUT
+static void client_flush(Server *sv, Client *c) {
+    while (c->out_off < c->out_len) {
+        ssize_t n = send(c->fd, c->out + c->out_off, c->out_len - c->out_off, MSG_NOSIGNAL);
+        if (n > 0) {
+            c->out_off += (size_t)n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            set_want_write(sv, c, true);
+            return;
+        } else {
+            c->quit = true; // Peer is gone; drop what is left
+            c->out_off = c->out_len;
+        }
+    }
+    c->out_off = c->out_len = 0;
+    set_want_write(sv, c, false);
+}
+
+// EXIT and QUIT end the connection, not the server
+static bool is_exit(const char *line) {
+    size_t len = strcspn(line, " \t");
+    if (line[len + strspn(line + len, " \t")] != '\0') return false;
+    return (len == 4 && (strncasecmp(line, "exit", 4) == 0 || strncasecmp(line, "quit", 4) == 0));
+}
+
+// Take the next complete line into c->line; a final unterminated line counts
+// once the peer has closed its side
+static bool next_line(Client *c) {
+    char *nl = memchr(c->in, '\n', c->in_len);
+    size_t len = nl ? (size_t)(nl - c->in) : c->in_len;
+    if (!nl && !(c->eof && c->in_len > 0)) {
+        if (c->in_len >= CLIENT_LINE_MAX) {
+            client_send(c, "Error: Command line too long.\n" SERVER_END);
+            c->quit = true;
+        }
+        return false;
+    }
+
+    size_t keep = len < CLIENT_LINE_MAX ? len : CLIENT_LINE_MAX - 1;
+    memcpy(c->line, c->in, keep);
+    c->line[keep] = '\0';
+    c->line[strcspn(c->line, "\r")] = '\0';
+    size_t used = nl ? len + 1 : len;
+    memmove(c->in, c->in + used, c->in_len - used);
+    c->in_len -= used;
+    return true;
+}
+
+// Run c's pending lines until one is handed to a worker
+static void client_dispatch(Server *sv, Client *c) {
+    while (!c->busy && !c->quit && next_line(c)) {
+        const char *p = c->line + strspn(c->line, " \t");
+        if (*p == '\0') {
+            client_send(c, SERVER_END);
+            continue;
+        }
+        if (is_exit(p)) {
+            client_send(c, "Goodbye.\n" SERVER_END);
+            c->quit = true;
+            break;
+        }
+        memmove(c->line, p, strlen(p) + 1);
+
+        c->busy = true;
+        pthread_mutex_lock(&sv->mu);
+        c->next = NULL;
+        if (sv->jobs_tail) sv->jobs_tail->next = c;
+        else sv->jobs_head = c;
+        sv->jobs_tail = c;
+        pthread_cond_signal(&sv->job_cv);
+        pthread_mutex_unlock(&sv->mu);
+    }
+}
+
+static void client_detach(Server *sv, Client *c) {
+    if (!c->detached) {
+        epoll_ctl(sv->epfd, EPOLL_CTL_DEL, c->fd, NULL);
+        c->detached = true;
+    }
+}
+
+static void client_free(Server *sv, Client *c) {
+    client_detach(sv, c);
+    close(c->fd);
+    if (c->all_prev) c->all_prev->all_next = c->all_next;
+    else sv->all = c->all_next;
+    if (c->all_next) c->all_next->all_prev = c->all_prev;
+    free(c->in);
+    free(c->out);
+    free(c);
+}
+
+// Close c once nothing is running, queued or unsent. Later entries of the
+// current epoll batch may still name c, so it is only freed after the batch.
+static void client_settle(Server *sv, Client *c) {
+    if (c->busy || c->out_len > 0 || c->closing) return;
+    if (c->quit || (c->eof && c->in_len == 0)) {
+        client_detach(sv, c);
+        c->closing = true;
+        c->dead_next = sv->dead;
+        sv->dead = c;
+    }
+}
+
+static void client_readable(Server *sv, Client *c) {
+    char chunk[CLIENT_READ_CHUNK];
+    for (;;) {
+        ssize_t n = recv(c->fd, chunk, sizeof chunk, 0);
+        if (n > 0) {
+            if (!c->quit && !buf_append(&c->in, &c->in_len, &c->in_cap, chunk, (size_t)n)) {
+                c->quit = true;
+            }
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        c->eof = true; // Orderly shutdown or a reset
+        if (n < 0) c->quit = true;
+        break;
+    }
+    set_want_write(sv, c, c->want_write);
+    client_dispatch(sv, c);
+    client_flush(sv, c);
+    client_settle(sv, c);
+}
+
+static void accept_clients(Server *sv, int listen_fd) {
+    for (;;) {
+        int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) perror("accept");
+            return;
+        }
+        Client *c = calloc(1, sizeof *c);
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = c };
+        if (!c || epoll_ctl(sv->epfd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            free(c);
+            close(fd);
+            continue;
+        }
+        c->fd = fd;
+        c->events = EPOLLIN;
+        c->all_next = sv->all;
+        if (sv->all) sv->all->all_prev = c;
+        sv->all = c;
+    }
+}
+
+// Hand finished commands' output back to their clients
+static void collect_done(Server *sv) {
+    uint64_t count;
+    ssize_t r = read(sv->wake_fd, &count, sizeof count);
+    (void)r;
+
+    pthread_mutex_lock(&sv->mu);
+    Client *c = sv->done;
+    sv->done = NULL;
+    pthread_mutex_unlock(&sv->mu);
+
+    while (c) {
+        Client *next = c->next;
+        if (c->result) {
+            if (!c->quit && !buf_append(&c->out, &c->out_len, &c->out_cap, c->result, c->result_len)) {
+                c->quit = true;
+            }
+            free(c->result);
+            c->result = NULL;
+        } else {
+            client_send(c, "Error: Out of memory while running command.\n" SERVER_END);
+        }
+        c->busy = false;
+        client_dispatch(sv, c);
+        client_flush(sv, c);
+        client_settle(sv, c);
+        c = next;
+    }
+}
+
+static int listen_on(const char *path) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(path) >= sizeof addr.sun_path) {
+        fprintf(stderr, "Socket path too long: %s\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    // Replace a socket left behind by an earlier run, but nothing else
+    struct stat st;
+    if (stat(path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+        unlink(path);
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+    if (bind(fd, (struct sockaddr *)&addr, sizeof addr) != 0 || listen(fd, SERVER_BACKLOG) != 0) {
+        perror(path);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static bool watch(int epfd, int fd, void *tag) {
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = tag };
+    return epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) == 0;
+}
+
+bool server_run(const char *socket_path, Store *s, const char *db_path) {
+    Server sv = {
+        .s = s,
+        .db_path = db_path,
+        .mu = PTHREAD_MUTEX_INITIALIZER,
+        .job_cv = PTHREAD_COND_INITIALIZER,
+        .epfd = -1,
+        .wake_fd = -1,
+    };
+    // Prefer writers so a steady stream of reads cannot starve updates
+    pthread_rwlockattr_t attr;
+    pthread_rwlockattr_init(&attr);
+    pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    pthread_rwlock_init(&sv.shared.lock, &attr);
+    pthread_rwlockattr_destroy(&attr);
+    version_domain_init(&sv.shared.versions);
+
+    // Take SIGINT/SIGTERM through the event loop; workers inherit the mask
+    sigset_t stop_signals, old_mask;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, &old_mask);
+
+    bool ok = false;
+    int listen_fd = listen_on(socket_path);
+    int signal_fd = signalfd(-1, &stop_signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    sv.wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    sv.epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (listen_fd < 0 || signal_fd < 0 || sv.wake_fd < 0 || sv.epfd < 0 ||
+        !watch(sv.epfd, listen_fd, &g_listen_tag) || !watch(sv.epfd, sv.wake_fd, &g_wake_tag) ||
+        !watch(sv.epfd, signal_fd, &g_signal_tag)) {
+        if (listen_fd >= 0) perror("server setup");
+        goto cleanup;
+    }
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t n_workers = cpus < 2 ? 2 : cpus > SERVER_MAX_WORKERS ? SERVER_MAX_WORKERS : (size_t)cpus;
+    pthread_t workers[SERVER_MAX_WORKERS];
+    size_t started = 0;
+    while (started < n_workers && pthread_create(&workers[started], NULL, worker_main, &sv) == 0) {
+        started++;
+    }
+    if (started == 0) {
+        fprintf(stderr, "Failed to start server workers\n");
+        goto cleanup;
+    }
+    ok = true;
+    printf("Serving %s on %s with %zu worker(s). Press Ctrl-C to stop.\n", db_path, socket_path, started);
+    fflush(stdout);
+
+    bool running = true;
+    struct epoll_event events[SERVER_EVENTS];
+    while (running) {
+        int n = epoll_wait(sv.epfd, events, SERVER_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            void *tag = events[i].data.ptr;
+            if (tag == &g_listen_tag) {
+                accept_clients(&sv, listen_fd);
+            } else if (tag == &g_wake_tag) {
+                collect_done(&sv);
+            } else if (tag == &g_signal_tag) {
+                // Consume it, or it would be delivered once the mask is restored
+                struct signalfd_siginfo info;
+                ssize_t r = read(signal_fd, &info, sizeof info);
+                (void)r;
+                running = false;
+            } else {
+                Client *c = tag;
+                if (c->closing) {
+                    continue;
+                }
+                if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+                    // Gone for good: stop polling, and free once any running command returns
+                    c->eof = c->quit = true;
+                    c->out_off = c->out_len = 0;
+                    client_detach(&sv, c);
+                    client_settle(&sv, c);
+                } else if (events[i].events & EPOLLIN) {
+                    client_readable(&sv, c); // May close c
+                } else if (events[i].events & EPOLLOUT) {
+                    client_flush(&sv, c);
+                    client_settle(&sv, c);
+                }
+            }
+        }
+        while (sv.dead) {
+            Client *c = sv.dead;
+            sv.dead = c->dead_next;
+            client_free(&sv, c);
+        }
+    }
+
+    pthread_mutex_lock(&sv.mu);
+    sv.stopping = true;
+    pthread_cond_broadcast(&sv.job_cv);
+    pthread_mutex_unlock(&sv.mu);
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    for (Client *c = sv.done; c; c = c->next) {
+        free(c->result);
+    }
+    while (sv.all) {
+        client_free(&sv, sv.all);
+    }
+    puts("Server stopped. Unsaved changes were not written; use SAVE before stopping to keep them.");
+
+cleanup:
+    if (sv.epfd >= 0) close(sv.epfd);
+    if (sv.wake_fd >= 0) close(sv.wake_fd);
+    if (signal_fd >= 0) close(signal_fd);
+    if (listen_fd >= 0) {
+        close(listen_fd);
+        unlink(socket_path);
+    }
+    pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+    pthread_rwlock_destroy(&sv.shared.lock);
+    version_domain_free(&sv.shared.versions);
+    return ok;
+}
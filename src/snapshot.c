@@ -0,0 +1,238 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "snapshot.h"
+
+#define SNAPSHOT_MAGIC "CMSB"
+#define SNAPSHOT_VERSION 1u
+
+// On-disk header, followed by the payload sections in this order:
+//   int32 ids[count], float marks[count],
+//   uint32 name_offsets[count + 1], name heap,
+//   uint32 prog_offsets[count + 1], programme heap.
+// Strings are stored without terminators; lengths come from the offset columns.
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t count;
+    uint64_t name_heap_len;
+    uint64_t prog_heap_len;
+    uint32_t checksum;      // CRC-32 of the payload
+    uint32_t reserved;
+} SnapshotHeader;
+
+static uint32_t crc_table[8][256];
+
+static void crc_init(void) {
+    if (crc_table[0][1] != 0) return;
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        crc_table[0][i] = c;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+        for (int t = 1; t < 8; t++) {
+            uint32_t prev = crc_table[t - 1][i];
+            crc_table[t][i] = (prev >> 8) ^ crc_table[0][prev & 0xFF];
+        }
+    }
+}
+
+// Slicing-by-8 CRC-32, pass the previous result to continue a running checksum
+static uint32_t crc32_update(uint32_t crc, const void *data, size_t len) {
+    const unsigned char *p = data;
+    crc = ~crc;
+    while (len >= 8) {
+        uint32_t lo, hi;
+        memcpy(&lo, p, 4);
+        memcpy(&hi, p + 4, 4);
+        lo ^= crc;
+        crc = crc_table[7][lo & 0xFF] ^ crc_table[6][(lo >> 8) & 0xFF] ^
+              crc_table[5][(lo >> 16) & 0xFF] ^ crc_table[4][lo >> 24] ^
+              crc_table[3][hi & 0xFF] ^ crc_table[2][(hi >> 8) & 0xFF] ^
+              crc_table[1][(hi >> 16) & 0xFF] ^ crc_table[0][hi >> 24];
+        p += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = crc_table[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+bool snapshot_is_binary(const char *path) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return false;
+    char magic[4];
+    bool is_bin = fread(magic, 1, sizeof magic, fp) == sizeof magic &&
+                  memcmp(magic, SNAPSHOT_MAGIC, sizeof magic) == 0;
+    fclose(fp);
+    return is_bin;
+}
+
+// Write a payload section and fold it into the running checksum
+static bool write_section(FILE *fp, const void *data, size_t len, uint32_t *crc) {
+    *crc = crc32_update(*crc, data, len);
+    return fwrite(data, 1, len, fp) == len;
+}
+
+bool snapshot_save(const char *path, const Store *s) {
+    crc_init();
+    size_t n = s->size;
+    uint32_t *name_offs = malloc((n + 1) * sizeof *name_offs);
+    uint32_t *prog_offs = malloc((n + 1) * sizeof *prog_offs);
+    FILE *fp = NULL;
+    bool ok = false;
+    if (!name_offs || !prog_offs) goto done;
+
+    name_offs[0] = prog_offs[0] = 0;
+    for (size_t i = 0; i < n; i++) {
+        name_offs[i + 1] = name_offs[i] + (uint32_t)strlen(store_name(s, i));
+        prog_offs[i + 1] = prog_offs[i] + (uint32_t)strlen(prog_name(s->progs[i]));
+    }
+
+    fp = fopen(path, "wb");
+    if (!fp) goto done;
+
+    SnapshotHeader h = {0};
+    memcpy(h.magic, SNAPSHOT_MAGIC, sizeof h.magic);
+    h.version = SNAPSHOT_VERSION;
+    h.count = n;
+    h.name_heap_len = name_offs[n];
+    h.prog_heap_len = prog_offs[n];
+    if (fwrite(&h, sizeof h, 1, fp) != 1) goto done;
+
+    uint32_t crc = 0;
+    // The ID and mark columns are written straight from the store
+    if (!write_section(fp, s->ids, n * sizeof(int32_t), &crc)) goto done;
+    if (!write_section(fp, s->marks, n * sizeof(float), &crc)) goto done;
+    if (!write_section(fp, name_offs, (n + 1) * sizeof *name_offs, &crc)) goto done;
+    for (size_t i = 0; i < n; i++) {
+        if (!write_section(fp, store_name(s, i), name_offs[i + 1] - name_offs[i], &crc)) goto done;
+    }
+    if (!write_section(fp, prog_offs, (n + 1) * sizeof *prog_offs, &crc)) goto done;
+    for (size_t i = 0; i < n; i++) {
+        if (!write_section(fp, prog_name(s->progs[i]), prog_offs[i + 1] - prog_offs[i], &crc)) goto done;
+    }
+
+    h.checksum = crc;
+    if (fseek(fp, 0, SEEK_SET) != 0 || fwrite(&h, sizeof h, 1, fp) != 1) goto done;
+    ok = true;
+
+done:
+    if (fp && fclose(fp) != 0) ok = false;
+    free(name_offs);
+    free(prog_offs);
+    return ok;
+}
+
+static void copy_string(char *dst, size_t dst_size, const char *heap, const uint32_t *offs, size_t i) {
+    size_t len = offs[i + 1] - offs[i];
+    if (len > dst_size - 1) len = dst_size - 1;
+    memcpy(dst, heap + offs[i], len);
+    dst[len] = '\0';
+}
+
+static ProgCode intern_string(const char *heap, const uint32_t *offs, size_t i) {
+    return prog_intern_len(heap + offs[i], offs[i + 1] - offs[i]);
+}
+
+// Map the snapshot, verify header and checksum, then copy the columns straight
+// into the store. Rows were validated when the snapshot was written.
+bool snapshot_load(const char *path, Store *s) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 || (size_t)sb.st_size < sizeof(SnapshotHeader)) {
+        close(fd);
+        return false;
+    }
+    size_t len = (size_t)sb.st_size;
+    const unsigned char *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return false;
+
+    bool ok = false;
+    SnapshotHeader h;
+    memcpy(&h, map, sizeof h);
+    if (memcmp(h.magic, SNAPSHOT_MAGIC, sizeof h.magic) != 0 || h.version != SNAPSHOT_VERSION) {
+        fprintf(stderr, "%s: unsupported snapshot format\n", path);
+        goto done;
+    }
+
+    size_t n = (size_t)h.count;
+    size_t payload = len - sizeof h;
+    size_t fixed = n * (sizeof(int32_t) + sizeof(float)) + 2 * (n + 1) * sizeof(uint32_t);
+    if (h.count > payload || fixed + h.name_heap_len + h.prog_heap_len != payload) {
+        fprintf(stderr, "%s: truncated or corrupt snapshot\n", path);
+        goto done;
+    }
+
+    crc_init();
+    const unsigned char *p = map + sizeof h;
+    if (crc32_update(0, p, payload) != h.checksum) {
+        fprintf(stderr, "%s: snapshot checksum mismatch\n", path);
+        goto done;
+    }
+
+    const unsigned char *ids = p;
+    const unsigned char *marks = ids + n * sizeof(int32_t);
+    uint32_t *name_offs = malloc((n + 1) * sizeof *name_offs);
+    uint32_t *prog_offs = malloc((n + 1) * sizeof *prog_offs);
+    const unsigned char *name_offs_src = marks + n * sizeof(float);
+    const char *name_heap = (const char *)(name_offs_src + (n + 1) * sizeof(uint32_t));
+    const unsigned char *prog_offs_src = (const unsigned char *)name_heap + h.name_heap_len;
+    const char *prog_heap = (const char *)(prog_offs_src + (n + 1) * sizeof(uint32_t));
+    if (!name_offs || !prog_offs) {
+        free(name_offs);
+        free(prog_offs);
+        goto done;
+    }
+    // Sections are not aligned in the file, copy the offset columns out once
+    memcpy(name_offs, name_offs_src, (n + 1) * sizeof *name_offs);
+    memcpy(prog_offs, prog_offs_src, (n + 1) * sizeof *prog_offs);
+    if (name_offs[n] != h.name_heap_len || prog_offs[n] != h.prog_heap_len) {
+        fprintf(stderr, "%s: truncated or corrupt snapshot\n", path);
+        free(name_offs);
+        free(prog_offs);
+        goto done;
+    }
+
+    if (s->size == 0) {
+        // With the arena reserved up front, setting the names cannot fail
+        if (store_reserve_names(s, h.name_heap_len + n) && store_append_raw(s, n)) {
+            memcpy(s->ids, ids, n * sizeof(int32_t));
+            memcpy(s->marks, marks, n * sizeof(float));
+            for (size_t i = 0; i < n; i++) {
+                store_set_name(s, i, name_heap + name_offs[i], name_offs[i + 1] - name_offs[i]);
+                s->progs[i] = intern_string(prog_heap, prog_offs, i);
+            }
+            store_reindex(s);
+            ok = true;
+        }
+    } else {
+        // Merging into a populated store still needs duplicate checks
+        ok = true;
+        for (size_t i = 0; i < n; i++) {
+            Student st = {0};
+            memcpy(&st.id, ids + i * sizeof(int32_t), sizeof(int32_t));
+            memcpy(&st.mark, marks + i * sizeof(float), sizeof(float));
+            copy_string(st.name, sizeof st.name, name_heap, name_offs, i);
+            st.programme = intern_string(prog_heap, prog_offs, i);
+            store_insert(s, st);
+        }
+    }
+    free(name_offs);
+    free(prog_offs);
+
+done:
+    munmap((void *)map, len);
+    return ok;
+}
@@ -1,32 +1,105 @@
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include "metrics.h"
 #include "sort.h"
 
-static int cmp_id_asc(const void *a, const void *b) {
-    const Student *x = (const Student*)a;
-    const Student *y = (const Student*)b;
-    return (x->id > y->id) - (x->id < y->id); // Avoids integer overflow
-}
+// LSD radix sort over (key, slot) words: the key is mapped to an unsigned
+// integer whose order matches the requested direction, packed above the slot,
+// and sorted 11 bits at a time. Each pass is stable, so equal keys keep store
+// order in both directions. A pass whose digit is the same for every row is
+// skipped.
+#define RADIX_BITS 11
+#define RADIX_SIZE (1u << RADIX_BITS)
+#define RADIX_PASSES 3   // ceil(32 / RADIX_BITS)
 
-static int cmp_mark_asc(const void *a, const void *b) {
-    const Student *x = (const Student*)a;
-    const Student *y = (const Student*)b;
-    return (x->mark > y->mark) - (x->mark < y->mark);
+// Map a float to an unsigned key that sorts in the same order
+static uint32_t float_key(float f) {
+    uint32_t bits;
+    if (f == 0.0f) f = 0.0f;   // -0.0 and 0.0 compare equal
+    memcpy(&bits, &f, sizeof bits);
+    return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
 }
 
-void store_sort(Store *s, SortKey key, bool asc) {
-    if (!s || s->size <= 1) return;
-    
+static uint32_t sort_key(const Store *s, SortKey key, size_t slot) {
     if (key == SORT_BY_ID) {
-        qsort(s->data, s->size, sizeof(Student), cmp_id_asc);
-    } else {
-        qsort(s->data, s->size, sizeof(Student), cmp_mark_asc);
+        return (uint32_t)s->ids[slot] ^ 0x80000000u;
     }
+    return float_key(s->marks[slot]);
+}
 
-    if (!asc) {
-        for (size_t i = 0, j = s->size-1; i<j; i++, j--) {
-            Student tmp = s->data[i];
-            s->data[i] = s->data[j];
-            s->data[j] = tmp;
+// Stable radix sort of the slots in seq (all slots in store order if NULL)
+static bool radix_order(const Store *s, SortKey key, bool asc, const size_t *seq, size_t *order) {
+    size_t n = s->size;
+    metrics_add(METRIC_ROWS_SORTED, n);
+    if (n <= 1) {
+        if (n == 1) order[0] = 0;
+        return true;
+    }
+
+    uint64_t *items = malloc(n * sizeof *items);
+    uint64_t *tmp = malloc(n * sizeof *tmp);
+    size_t (*count)[RADIX_SIZE] = calloc(RADIX_PASSES, sizeof *count);
+    if (!items || !tmp || !count) {
+        free(items);
+        free(tmp);
+        free(count);
+        return false;
+    }
+
+    // Descending order sorts the complemented key ascending
+    uint32_t flip = asc ? 0u : UINT32_MAX;
+    for (size_t i = 0; i < n; i++) {
+        size_t slot = seq ? seq[i] : i;
+        uint32_t k = sort_key(s, key, slot) ^ flip;
+        items[i] = (uint64_t)k << 32 | (uint32_t)slot;
+        for (int p = 0; p < RADIX_PASSES; p++) {
+            count[p][(k >> (p * RADIX_BITS)) & (RADIX_SIZE - 1)]++;
+        }
+    }
+
+    for (int p = 0; p < RADIX_PASSES; p++) {
+        unsigned shift = 32 + p * RADIX_BITS;
+        if (count[p][(items[0] >> shift) & (RADIX_SIZE - 1)] == n) {
+            continue;   // Every row has the same digit here
+        }
+        size_t offset = 0;
+        for (size_t d = 0; d < RADIX_SIZE; d++) {
+            size_t c = count[p][d];
+            count[p][d] = offset;
+            offset += c;
+        }
+        for (size_t i = 0; i < n; i++) {
+            tmp[count[p][(items[i] >> shift) & (RADIX_SIZE - 1)]++] = items[i];
         }
+        uint64_t *swap = items;
+        items = tmp;
+        tmp = swap;
     }
-}
\ No newline at end of file
+
+    for (size_t i = 0; i < n; i++) {
+        order[i] = (uint32_t)items[i];
+    }
+    free(items);
+    free(tmp);
+    free(count);
+    return true;
+}
+
+bool store_sort_order(const Store *s, SortKey key, bool asc, size_t *order) {
+    return radix_order(s, key, asc, NULL, order);
+}
+
+bool store_sort_refine(const Store *s, SortKey key, bool asc, size_t *order) {
+    return radix_order(s, key, asc, order, order);
+}
+
+void store_sort(Store *s, SortKey key, bool asc) {
+    if (!s || s->size <= 1) return;
+
+    size_t *order = malloc(s->size * sizeof *order);
+    if (order && store_sort_order(s, key, asc, order)) {
+        store_apply_order(s, order);
+    }
+    free(order);
+}
@@ -1,40 +1,44 @@
 #include "stats.h"
+#include "markscan.h"
 #include "student.h"
 
-Stats compute_stats(const Student *arr, size_t size) {
+Stats compute_stats(const float *marks, size_t size) {
     Stats stats = {0};
-    stats.min_idx = -1;
-    stats.max_idx = -1;
+    MarkScanStats scan;
+    markscan_stats(marks, size, &scan);
+    stats.min_idx = scan.min_idx;
+    stats.max_idx = scan.max_idx;
     if (size == 0) return stats;
-    float sum = 0.0f;
-    stats.min_mark = arr[0].mark;
-    stats.max_mark = arr[0].mark;
-    stats.min_idx, stats.max_idx = 0;
-
-    for (size_t i = 0; i < size; i++) {
-        float m = arr[i].mark;
-        sum += m;
-
-        if (m < stats.min_mark) {
-            stats.min_mark = m;
-            stats.min_idx = (int)i;
-        }
-        if (m > stats.max_mark) {
-            stats.max_mark = m;
-            stats.max_idx = (int)i;
-        }
-
-        // Grade bands: A>=85, B 75-84, C 65-74, D 50-64, F<50
-        if (m >= 85) stats.band_A++;
-        else if (m < 85 && m >= 75) stats.band_B++;
-        else if (m < 75 && m >= 65) stats.band_C++;
-        else if (m < 65 && m >= 50) stats.band_D++;
-        else stats.band_F++;
-
-    }
 
     stats.count = size;
-    stats.average = sum / (float)size;
+    stats.average = (float)(scan.sum / (double)size);
+    stats.min_mark = scan.min;
+    stats.max_mark = scan.max;
+    stats.band_A = (int)scan.band[0];
+    stats.band_B = (int)scan.band[1];
+    stats.band_C = (int)scan.band[2];
+    stats.band_D = (int)scan.band[3];
+    stats.band_F = (int)scan.band[4];
+    return stats;
+}
+
+Stats store_summary(const Store *s) {
+    Stats stats = {0};
+    stats.min_idx = -1;
+    stats.max_idx = -1;
+    if (s->size == 0) return stats;
 
+    const StoreAgg *a = &s->agg;
+    stats.count = s->size;
+    stats.average = (float)(a->sum / (double)s->size);
+    stats.min_idx = store_find_index_by_id(s, markindex_min_id(&s->mark_index));
+    stats.max_idx = store_find_index_by_id(s, markindex_max_id(&s->mark_index));
+    if (stats.min_idx >= 0) stats.min_mark = s->marks[stats.min_idx];
+    if (stats.max_idx >= 0) stats.max_mark = s->marks[stats.max_idx];
+    stats.band_A = (int)a->band[0];
+    stats.band_B = (int)a->band[1];
+    stats.band_C = (int)a->band[2];
+    stats.band_D = (int)a->band[3];
+    stats.band_F = (int)a->band[4];
     return stats;
-}
\ No newline at end of file
+}
@@ -1,10 +1,239 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <string.h>
 #include "store.h"
+#include "markscan.h"
+#include "metrics.h"
 #include "util.h"
 
 #define START_CAP 16
+#define ARENA_START_CAP 4096
+#define ARENA_COMPACT_MIN (64 * 1024)   // Dead name bytes worth a compaction
+
+// Scramble the ID bits so sequential IDs spread over the whole table
+static size_t hash_id(int id) {
+    uint32_t h = (uint32_t)id;
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return (size_t)h;
+}
+
+// Return the table position holding id, or the empty position where it would go
+static size_t index_probe(const Store *s, int id) {
+    size_t mask = s->index_cap - 1;
+    size_t pos = hash_id(id) & mask;
+    while (s->index[pos] != 0 && s->ids[s->index[pos] - 1] != id) {
+        pos = (pos + 1) & mask;
+    }
+    return pos;
+}
+
+static void index_put(Store *s, int id, size_t slot) {
+    s->index[index_probe(s, id)] = (unsigned)(slot + 1);
+}
+
+// Backward-shift deletion keeps probe chains intact without tombstones
+static void index_remove(Store *s, int id) {
+    size_t mask = s->index_cap - 1;
+    size_t hole = index_probe(s, id);
+    if (s->index[hole] == 0) return;
+
+    size_t pos = hole;
+    for (;;) {
+        pos = (pos + 1) & mask;
+        unsigned entry = s->index[pos];
+        if (entry == 0) break;
+        size_t home = hash_id(s->ids[entry - 1]) & mask;
+        // Move the entry back only if its home does not lie cyclically in (hole, pos]
+        bool movable = (hole <= pos) ? (home <= hole || home > pos)
+                                     : (home <= hole && home > pos);
+        if (movable) {
+            s->index[hole] = entry;
+            hole = pos;
+        }
+    }
+    s->index[hole] = 0;
+}
+
+static bool index_rebuild(Store *s, size_t new_cap) {
+    unsigned *table = calloc(new_cap, sizeof *table);
+    if (!table) {
+        return false;
+    }
+    free(s->index);
+    s->index = table;
+    s->index_cap = new_cap;
+    for (size_t i = 0; i < s->size; i++) {
+        index_put(s, s->ids[i], i);
+    }
+    return true;
+}
+
+int mark_band(float m) {
+    // Grade bands: A>=85, B 75-84, C 65-74, D 50-64, F<50
+    if (m >= GRADE_A_MIN) return 0;
+    if (m >= GRADE_B_MIN) return 1;
+    if (m >= GRADE_C_MIN) return 2;
+    if (m >= GRADE_D_MIN) return 3;
+    return 4;
+}
+
+static void log_key(Store *s, size_t slot, bool added) {
+    StoreChange *c = &s->log[s->log_next % STORE_LOG_CAP];
+    c->id = s->ids[slot];
+    c->mark = s->marks[slot];
+    c->added = added;
+    s->log_next++;
+}
+
+// Bulk changes are not logged: readers of the log must rebuild
+static void log_reset(Store *s) {
+    s->log_floor = s->log_next;
+}
+
+static size_t width_bucket(size_t len) {
+    return len < WIDTH_BUCKETS ? len : WIDTH_BUCKETS - 1;
+}
+
+// Count (delta = 1) or uncount (delta = -1) the cell lengths of the record at slot
+static void widths_track(Store *s, size_t slot, int delta) {
+    char cell[24];
+    StoreWidths *w = &s->widths;
+    w->id[width_bucket(fmt_int(cell, s->ids[slot]))] += (size_t)delta;
+    w->name[width_bucket(strlen(store_name(s, slot)))] += (size_t)delta;
+    w->prog[width_bucket(strlen(prog_name(s->progs[slot])))] += (size_t)delta;
+    w->mark[width_bucket(fmt_mark(cell, s->marks[slot]))] += (size_t)delta;
+}
+
+size_t store_width(const size_t hist[WIDTH_BUCKETS]) {
+    for (size_t len = WIDTH_BUCKETS; len-- > 0;) {
+        if (hist[len]) return len;
+    }
+    return 0;
+}
+
+static void agg_reset(StoreAgg *a) {
+    memset(a, 0, sizeof *a);
+}
+
+// Account for the record at slot in the aggregates, the mark index and the change log
+static void agg_add(Store *s, size_t slot) {
+    float m = s->marks[slot];
+    s->agg.sum += m;
+    s->agg.band[mark_band(m)]++;
+    log_key(s, slot, true);
+    if (!markindex_insert(&s->mark_index, m, s->ids[slot])) {
+        fprintf(stderr, "Out of memory while indexing mark of ID %d\n", s->ids[slot]);
+    }
+}
+
+// Forget the record at slot before it is overwritten or its mark or ID changes
+static void agg_remove(Store *s, size_t slot) {
+    float m = s->marks[slot];
+    s->agg.sum -= m;
+    s->agg.band[mark_band(m)]--;
+    log_key(s, slot, false);
+    markindex_remove(&s->mark_index, m, s->ids[slot]);
+    if (s->size == 1) {
+        s->agg.sum = 0.0; // Drop accumulated rounding once empty
+    }
+}
+
+// Trigram postings for the name of the record at slot
+static void grams_add(Store *s, size_t slot) {
+    if (!trigram_add(&s->name_grams, store_name(s, slot), s->ids[slot])) {
+        fprintf(stderr, "Out of memory while indexing name of ID %d\n", s->ids[slot]);
+    }
+}
+
+static void grams_remove(Store *s, size_t slot) {
+    trigram_remove(&s->name_grams, store_name(s, slot), s->ids[slot]);
+}
+
+static size_t touched_words(size_t cap) {
+    size_t blocks = (cap + STORE_BLOCK_ROWS - 1) / STORE_BLOCK_ROWS;
+    return (blocks + 63) / 64;
+}
+
+static void touch(Store *s, size_t slot) {
+    size_t b = slot / STORE_BLOCK_ROWS;
+    s->touched[b / 64] |= (uint64_t)1 << (b % 64);
+}
+
+// Grow one column; on failure the old block stays valid and untouched
+static bool grow_column(void **col, size_t new_cap, size_t elem) {
+    void *grown = realloc(*col, new_cap * elem);
+    if (!grown) {
+        return false;
+    }
+    *col = grown;
+    return true;
+}
+
+// Make room for extra bytes of names; offsets are 32-bit
+static bool arena_reserve(Store *s, size_t extra) {
+    size_t need = s->arena_len + extra;
+    if (need <= s->arena_cap) {
+        return true;
+    }
+    if (need > UINT32_MAX) {
+        return false;
+    }
+    size_t new_cap = s->arena_cap ? s->arena_cap : ARENA_START_CAP;
+    while (new_cap < need) {
+        new_cap *= 2;
+    }
+    if (!grow_column((void **)&s->name_arena, new_cap, 1)) {
+        return false;
+    }
+    metrics_add(METRIC_GROW_REALLOCS, 1);
+    metrics_add(METRIC_GROW_BYTES, s->arena_len);
+    s->arena_cap = new_cap;
+    return true;
+}
+
+// Append len bytes of name to the arena as slot's name; room must be reserved
+static void name_put(Store *s, size_t slot, const char *name, size_t len) {
+    s->name_off[slot] = (uint32_t)s->arena_len;
+    memcpy(s->name_arena + s->arena_len, name, len);
+    s->name_arena[s->arena_len + len] = '\0';
+    s->arena_len += len + 1;
+}
+
+// Slot's name is about to be replaced or deleted
+static void name_drop(Store *s, size_t slot) {
+    s->arena_dead += strlen(store_name(s, slot)) + 1;
+}
+
+// Repack the live names in slot order once at least half the arena is dead.
+// If memory is short the dead bytes just stay until the next try.
+static void arena_maybe_compact(Store *s) {
+    if (s->arena_dead < ARENA_COMPACT_MIN || s->arena_dead * 2 < s->arena_len) {
+        return;
+    }
+    size_t live = s->arena_len - s->arena_dead;
+    char *packed = malloc(live);
+    if (!packed) {
+        return;
+    }
+    size_t len = 0;
+    for (size_t i = 0; i < s->size; i++) {
+        const char *name = store_name(s, i);
+        size_t n = strlen(name) + 1;
+        memcpy(packed + len, name, n);
+        s->name_off[i] = (uint32_t)len;
+        len += n;
+    }
+    free(s->name_arena);
+    s->name_arena = packed;
+    s->arena_len = len;
+    s->arena_cap = live;
+    s->arena_dead = 0;
+}
 
 static bool ensure_cap(Store *s, size_t need) {
     if (s->cap >= need) {
@@ -15,96 +244,323 @@ static bool ensure_cap(Store *s, size_t need) {
         new_cap *= 2;
     }
 
-    Student *new_alloc = realloc(s->data, new_cap * sizeof(Student));
-    if (!new_alloc) {
+    if (!grow_column((void **)&s->ids, new_cap, sizeof *s->ids) ||
+        !grow_column((void **)&s->marks, new_cap, sizeof *s->marks) ||
+        !grow_column((void **)&s->name_off, new_cap, sizeof *s->name_off) ||
+        !grow_column((void **)&s->progs, new_cap, sizeof *s->progs)) {
+        return false;
+    }
+    metrics_add(METRIC_GROW_REALLOCS, 4);
+    metrics_add(METRIC_GROW_BYTES, s->size * (sizeof *s->ids + sizeof *s->marks +
+                                              sizeof *s->name_off + sizeof *s->progs));
+    size_t old_words = touched_words(s->cap), new_words = touched_words(new_cap);
+    if (new_words > old_words) {
+        if (!grow_column((void **)&s->touched, new_words, sizeof *s->touched)) {
+            return false;
+        }
+        memset(s->touched + old_words, 0, (new_words - old_words) * sizeof *s->touched);
+    }
+
+    // Slots survive realloc, only the table needs to grow with the columns.
+    // Commit the capacity only once the table fits it, so a failed rebuild
+    // never leaves more slots than the table can hold.
+    if (s->index_cap < new_cap * 2 && !index_rebuild(s, new_cap * 2)) {
         return false;
     }
-    s->data = new_alloc;
     s->cap = new_cap;
     return true;
 }
 
 void store_init(Store *s) {
-    s->data = NULL;
+    s->ids = NULL;
+    s->marks = NULL;
+    s->name_off = NULL;
+    s->progs = NULL;
+    s->name_arena = NULL;
+    s->arena_len = 0;
+    s->arena_cap = 0;
+    s->arena_dead = 0;
     s->size = 0;
     s->cap = 0;
+    s->index = NULL;
+    s->index_cap = 0;
+    agg_reset(&s->agg);
+    memset(&s->widths, 0, sizeof s->widths);
+    markindex_init(&s->mark_index);
+    trigram_init(&s->name_grams);
+    s->generation = 0;
+    s->saved_generation = 0;
+    s->log_next = 0;
+    s->log_floor = 0;
+    s->touched = NULL;
+    s->touched_all = true;
 }
 
 void store_free(Store *s) {
-    free(s->data);
-    s->data = NULL;
+    free(s->ids);
+    free(s->marks);
+    free(s->name_off);
+    free(s->progs);
+    free(s->name_arena);
+    free(s->index);
+    free(s->touched);
+    s->ids = NULL;
+    s->marks = NULL;
+    s->name_off = NULL;
+    s->progs = NULL;
+    s->name_arena = NULL;
+    s->arena_len = 0;
+    s->arena_cap = 0;
+    s->arena_dead = 0;
     s->size = 0;
     s->cap = 0;
+    s->index = NULL;
+    s->index_cap = 0;
+    s->touched = NULL;
+    s->touched_all = true;
+    agg_reset(&s->agg);
+    memset(&s->widths, 0, sizeof s->widths);
+    markindex_free(&s->mark_index);
+    trigram_free(&s->name_grams);
+}
+
+void store_clear_touched(Store *s) {
+    if (s->touched) {
+        memset(s->touched, 0, touched_words(s->cap) * sizeof *s->touched);
+    }
+    s->touched_all = false;
+}
+
+// Duplicate n elements of a column, allocating at least one
+static void *copy_column(const void *src, size_t n, size_t elem) {
+    void *dst = malloc(n ? n * elem : 1);
+    if (dst && n) {
+        memcpy(dst, src, n * elem);
+    }
+    return dst;
+}
+
+bool store_copy_rows(Store *dst, const Store *src) {
+    store_init(dst);
+    dst->ids = copy_column(src->ids, src->size, sizeof *src->ids);
+    dst->marks = copy_column(src->marks, src->size, sizeof *src->marks);
+    dst->name_off = copy_column(src->name_off, src->size, sizeof *src->name_off);
+    dst->progs = copy_column(src->progs, src->size, sizeof *src->progs);
+    dst->name_arena = copy_column(src->name_arena, src->arena_len, 1);
+    if (!dst->ids || !dst->marks || !dst->name_off || !dst->progs || !dst->name_arena) {
+        store_free(dst);
+        return false;
+    }
+    dst->size = dst->cap = src->size;
+    dst->arena_len = dst->arena_cap = src->arena_len;
+    dst->arena_dead = src->arena_dead;
+    dst->generation = dst->saved_generation = src->generation;
+    return true;
+}
+
+bool store_reserve(Store *s, size_t need) {
+    return ensure_cap(s, need);
 }
 
 int store_find_index_by_id(const Store *s, int id) {
+    if (s->size == 0) {
+        return -1;
+    }
+    unsigned entry = s->index[index_probe(s, id)];
+    return entry ? (int)(entry - 1) : -1;
+}
+
+Student store_get(const Store *s, size_t slot) {
+    Student st = {0};
+    st.id = s->ids[slot];
+    const char *name = store_name(s, slot);
+    memcpy(st.name, name, strlen(name) + 1);
+    st.programme = s->progs[slot];
+    st.mark = s->marks[slot];
+    return st;
+}
+
+void store_reindex(Store *s) {
+    s->generation++;
+    s->touched_all = true;
+    log_reset(s);
+    agg_reset(&s->agg);
+    memset(&s->widths, 0, sizeof s->widths);
+    markindex_free(&s->mark_index);
+    trigram_free(&s->name_grams);
+    if (s->index_cap == 0) {
+        return;
+    }
+    memset(s->index, 0, s->index_cap * sizeof *s->index);
     for (size_t i = 0; i < s->size; i++) {
-        if (s->data[i].id == id) {
-            return (int)i;
-        }
+        index_put(s, s->ids[i], i);
+        grams_add(s, i);
+        widths_track(s, i, 1);
+    }
+    MarkScanStats scan;
+    markscan_stats(s->marks, s->size, &scan);
+    s->agg.sum = scan.sum;
+    memcpy(s->agg.band, scan.band, sizeof s->agg.band);
+    if (!markindex_build(&s->mark_index, s->marks, s->ids, s->size)) {
+        fprintf(stderr, "Out of memory while rebuilding mark index\n");
     }
-    return -1;
 }
 
-bool store_insert(Store *s, Student st) {
-    // if (!valid_id(st.id) || !valid_mark(st.mark) || !valid_text(st.name) || !valid_text(st.programme)) {
-    //     return false;
-    // }
-    if (!valid_id(st.id)) {
-        fprintf(stderr, "Invalid ID: %d\n", st.id);
+// Gather one column into a fresh block of cap elements in the given order
+static bool permute_column(void **col, const size_t *order, size_t n, size_t cap, size_t elem) {
+    unsigned char *dst = malloc((cap ? cap : 1) * elem);
+    if (!dst) {
+        return false;
+    }
+    const unsigned char *src = *col;
+    for (size_t i = 0; i < n; i++) {
+        memcpy(dst + i * elem, src + order[i] * elem, elem);
+    }
+    free(*col);
+    *col = dst;
+    return true;
+}
+
+bool store_apply_order(Store *s, const size_t *order) {
+    if (!permute_column((void **)&s->ids, order, s->size, s->cap, sizeof *s->ids) ||
+        !permute_column((void **)&s->marks, order, s->size, s->cap, sizeof *s->marks) ||
+        !permute_column((void **)&s->name_off, order, s->size, s->cap, sizeof *s->name_off) ||
+        !permute_column((void **)&s->progs, order, s->size, s->cap, sizeof *s->progs)) {
+        return false;
+    }
+
+    // Keys are unchanged, only slots moved: the mark and name indexes stay valid
+    s->generation++;
+    s->touched_all = true;
+    memset(s->index, 0, s->index_cap * sizeof *s->index);
+    for (size_t i = 0; i < s->size; i++) {
+        index_put(s, s->ids[i], i);
+    }
+    return true;
+}
+
+bool store_append_raw(Store *s, size_t n) {
+    if (!ensure_cap(s, s->size + n)) {
         return false;
     }
-    if (!valid_text(st.name)) {
-        fprintf(stderr, "Invalid Name: %s\n", st.name);
+    s->size += n;
+    s->generation++;
+    s->touched_all = true;
+    log_reset(s);
+    return true;
+}
+
+bool store_set_name(Store *s, size_t slot, const char *name, size_t len) {
+    len = strnlen(name, len < NAME_LEN - 1 ? len : NAME_LEN - 1);
+    if (!arena_reserve(s, len + 1)) {
+        return false;
+    }
+    name_put(s, slot, name, len);
+    return true;
+}
+
+bool store_reserve_names(Store *s, size_t bytes) {
+    return arena_reserve(s, bytes);
+}
+
+bool store_can_insert(const Store *s, const Student *st) {
+    if (!valid_id(st->id)) {
+        fprintf(stderr, "Invalid ID: %d\n", st->id);
         return false;
     }
-    if (!valid_text(st.programme)) {
-        fprintf(stderr, "Invalid Programme: %s\n", st.programme);
+    if (!valid_text(st->name)) {
+        fprintf(stderr, "Invalid Name: %s\n", st->name);
         return false;
     }
-    if (!valid_mark(st.mark)) {
-        fprintf(stderr, "Invalid Mark: %.2f\n", st.mark);
+    if (!valid_mark(st->mark)) {
+        fprintf(stderr, "Invalid Mark: %.2f\n", st->mark);
         return false;
     }
+    return store_find_index_by_id(s, st->id) == -1; // Duplicate ID
+}
 
-    if (store_find_index_by_id(s, st.id) != -1) {
-        return false; // Duplicate ID
+bool store_insert(Store *s, Student st) {
+    // if (!valid_id(st.id) || !valid_mark(st.mark) || !valid_text(st.name) || !valid_text(st.programme)) {
+    //     return false;
+    // }
+    if (st.programme == PROG_NONE) {
+        fprintf(stderr, "Invalid Programme: %s\n", prog_name(st.programme));
+        return false;
+    }
+    if (!store_can_insert(s, &st)) {
+        return false;
     }
+    return store_insert_trusted(s, st);
+}
 
-    if (!ensure_cap(s, s->size + 1)) {
+bool store_insert_trusted(Store *s, Student st) {
+    size_t name_len = strnlen(st.name, NAME_LEN - 1);
+    if (!ensure_cap(s, s->size + 1) || !arena_reserve(s, name_len + 1)) {
         return false; // Memory allocation failed
     }
 
-    s->data[s->size++] = st;
+    size_t slot = s->size;
+    s->ids[slot] = st.id;
+    s->marks[slot] = st.mark;
+    name_put(s, slot, st.name, name_len);
+    s->progs[slot] = st.programme;
+    touch(s, slot);
+    index_put(s, st.id, slot);
+    s->size++;
+    s->generation++;
+    agg_add(s, s->size - 1);
+    grams_add(s, s->size - 1);
+    widths_track(s, s->size - 1, 1);
+    return true;
+}
+
+bool store_can_update(const Store *s, int id, const Student *patch) {
+    if (store_find_index_by_id(s, id) < 0) return false;
+    bool new_id = patch->id > 0 && patch->id != id;
+    bool new_name = patch->name[0] != '\0';
+    bool new_mark = patch->mark >= 0.0f;
+    if (new_id && (!valid_id(patch->id) || store_find_index_by_id(s, patch->id) != -1)) return false;
+    if (new_name && !valid_text(patch->name)) return false;
+    if (new_mark && !valid_mark(patch->mark)) return false;
     return true;
 }
 
 bool store_update(Store *s, int id, const Student *patch) {
+    // Validate the whole patch first so a rejected update changes nothing
+    if (!store_can_update(s, id, patch)) return false;
     int idx = store_find_index_by_id(s, id);
-    if (idx < 0) return false;
-    Student *cur = &s->data[idx];
-    if (patch->id > 0 && patch->id != id) {
-        if (!valid_id(patch->id)) return false;
-        if (store_find_index_by_id(s, patch->id) != -1) return false;
-        cur->id = patch->id;
-    }
+    bool new_id = patch->id > 0 && patch->id != id;
+    bool new_name = patch->name[0] != '\0';
+    bool new_prog = patch->programme != PROG_NONE;
+    bool new_mark = patch->mark >= 0.0f;
+    size_t name_len = new_name ? strnlen(patch->name, NAME_LEN - 1) : 0;
+    if (new_name && !arena_reserve(s, name_len + 1)) return false;
 
-    if (patch->name[0] != '\0') {
-        if (!valid_text(patch->name)) return false;
-        strncpy(cur->name, patch->name, sizeof(cur->name));
-        cur->name[sizeof(cur->name)-1] = '\0';
+    // Drop index entries keyed on fields that change, then re-add them
+    widths_track(s, (size_t)idx, -1);
+    if (new_id || new_mark) agg_remove(s, (size_t)idx);
+    if (new_id || new_name) grams_remove(s, (size_t)idx);
+    if (new_id) {
+        index_remove(s, id);
+        s->ids[idx] = patch->id;
+        index_put(s, patch->id, (size_t)idx);
     }
-
-    if (patch->programme[0] != '\0') {
-        if (!valid_text(patch->programme)) return false;
-        strncpy(cur->programme, patch->programme, sizeof(cur->programme));
-        cur->programme[sizeof(cur->programme)-1] = '\0';
+    if (new_name) {
+        name_drop(s, (size_t)idx);
+        name_put(s, (size_t)idx, patch->name, name_len);
     }
-
-    if (patch->mark >= 0.0f) {
-        if (!valid_mark(patch->mark)) return false;
-        cur->mark = patch->mark;
+    if (new_prog) {
+        s->progs[idx] = patch->programme;
     }
+    if (new_mark) {
+        s->marks[idx] = patch->mark;
+    }
+    touch(s, (size_t)idx);
+    if (new_id || new_mark) agg_add(s, (size_t)idx);
+    if (new_id || new_name) grams_add(s, (size_t)idx);
+    widths_track(s, (size_t)idx, 1);
+    s->generation++;
+    arena_maybe_compact(s);
 
     return true;
 }
@@ -112,7 +568,24 @@ bool store_update(Store *s, int id, const Student *patch) {
 bool store_delete(Store *s, int id) {
     int idx = store_find_index_by_id(s, id);
     if (idx < 0) return false;
-    s->data[idx] = s->data[s->size - 1]; // Swap with last student record
+    size_t last = s->size - 1;
+    index_remove(s, id);
+    agg_remove(s, (size_t)idx);
+    grams_remove(s, (size_t)idx);
+    widths_track(s, (size_t)idx, -1);
+    name_drop(s, (size_t)idx);
+    if ((size_t)idx != last) {
+        // Swap with last student record
+        s->ids[idx] = s->ids[last];
+        s->marks[idx] = s->marks[last];
+        s->name_off[idx] = s->name_off[last];
+        s->progs[idx] = s->progs[last];
+        index_put(s, s->ids[idx], (size_t)idx);
+        touch(s, (size_t)idx);
+    }
+    touch(s, last);
     s->size--;
+    s->generation++;
+    arena_maybe_compact(s);
     return true;
 }
\ No newline at end of file
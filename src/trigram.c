@@ -0,0 +1,242 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "trigram.h"
+
+#define MAX_GRAMS 256 // Distinct trigrams considered per string
+
+// Queries may share an index under a read lock; the lazy posting sort is the
+// only write they make
+static pthread_mutex_t sort_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static unsigned char fold(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? (unsigned char)(c - 'A' + 'a') : c;
+}
+
+// Distinct case-folded trigram codes of text, returns how many were written
+static size_t extract_grams(const char *text, uint32_t *grams) {
+    size_t n = 0;
+    size_t len = strlen(text);
+    for (size_t i = 0; i + 3 <= len && n < MAX_GRAMS; i++) {
+        uint32_t g = (uint32_t)fold((unsigned char)text[i]) << 16 |
+                     (uint32_t)fold((unsigned char)text[i + 1]) << 8 |
+                     (uint32_t)fold((unsigned char)text[i + 2]);
+        bool seen = false;
+        for (size_t k = 0; k < n && !seen; k++) seen = grams[k] == g;
+        if (!seen) grams[n++] = g;
+    }
+    return n;
+}
+
+static size_t hash_gram(uint32_t g) {
+    return (size_t)((g * 2654435761u) ^ (g >> 11));
+}
+
+void trigram_init(TrigramIndex *ti) {
+    ti->keys = NULL;
+    ti->lists = NULL;
+    ti->cap = 0;
+    ti->used = 0;
+}
+
+void trigram_free(TrigramIndex *ti) {
+    for (size_t i = 0; i < ti->cap; i++) {
+        free(ti->lists[i].ids);
+        free(ti->lists[i].gone);
+    }
+    free(ti->keys);
+    free(ti->lists);
+    trigram_init(ti);
+}
+
+static size_t find_slot(const TrigramIndex *ti, uint32_t g) {
+    size_t mask = ti->cap - 1;
+    size_t pos = hash_gram(g) & mask;
+    while (ti->keys[pos] != 0 && ti->keys[pos] != g + 1) {
+        pos = (pos + 1) & mask;
+    }
+    return pos;
+}
+
+static bool grow(TrigramIndex *ti) {
+    size_t new_cap = ti->cap ? ti->cap * 2 : 1024;
+    TrigramIndex next = {
+        .keys = calloc(new_cap, sizeof(uint32_t)),
+        .lists = calloc(new_cap, sizeof(Posting)),
+        .cap = new_cap,
+        .used = ti->used,
+    };
+    if (!next.keys || !next.lists) {
+        free(next.keys);
+        free(next.lists);
+        return false;
+    }
+    for (size_t i = 0; i < ti->cap; i++) {
+        if (ti->keys[i] == 0) continue;
+        size_t pos = find_slot(&next, ti->keys[i] - 1);
+        next.keys[pos] = ti->keys[i];
+        next.lists[pos] = ti->lists[i];
+    }
+    free(ti->keys);
+    free(ti->lists);
+    *ti = next;
+    return true;
+}
+
+// Posting list for g, created on demand; NULL if missing and !create
+static Posting *lookup(TrigramIndex *ti, uint32_t g, bool create) {
+    if (ti->cap == 0 || (create && (ti->used + 1) * 2 > ti->cap)) {
+        if (!create || !grow(ti)) return NULL;
+    }
+    size_t pos = find_slot(ti, g);
+    if (ti->keys[pos] == 0) {
+        if (!create) return NULL;
+        ti->keys[pos] = g + 1;
+        ti->lists[pos].sorted = true;
+        ti->used++;
+    }
+    return &ti->lists[pos];
+}
+
+static int cmp_id(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+// Sort ids and drop the queued removals in one merge pass. Each queued id
+// cancels one occurrence, so an id removed and added again stays listed.
+static void ensure_sorted(Posting *p) {
+    if (p->sorted && p->n_gone == 0) return;
+    if (!p->sorted) {
+        qsort(p->ids, p->count, sizeof *p->ids, cmp_id);
+        p->sorted = true;
+    }
+    if (p->n_gone == 0) return;
+    qsort(p->gone, p->n_gone, sizeof *p->gone, cmp_id);
+    size_t k = 0, g = 0;
+    for (size_t i = 0; i < p->count; i++) {
+        while (g < p->n_gone && p->gone[g] < p->ids[i]) g++;
+        if (g < p->n_gone && p->gone[g] == p->ids[i]) {
+            g++;
+            continue;
+        }
+        p->ids[k++] = p->ids[i];
+    }
+    p->count = k;
+    p->n_gone = 0;
+}
+
+// Lower bound of id in a sorted posting list
+static size_t lower_bound(const Posting *p, int id) {
+    size_t lo = 0, hi = p->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (p->ids[mid] < id) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+bool trigram_add(TrigramIndex *ti, const char *text, int id) {
+    uint32_t grams[MAX_GRAMS];
+    size_t n = extract_grams(text, grams);
+    for (size_t i = 0; i < n; i++) {
+        Posting *p = lookup(ti, grams[i], true);
+        if (!p) return false;
+        if (p->count == p->cap) {
+            size_t new_cap = p->cap ? p->cap * 2 : 4;
+            int *grown = realloc(p->ids, new_cap * sizeof *grown);
+            if (!grown) return false;
+            p->ids = grown;
+            p->cap = new_cap;
+        }
+        if (p->count > 0 && p->ids[p->count - 1] > id) p->sorted = false;
+        p->ids[p->count++] = id;
+    }
+    return true;
+}
+
+// Queue id on each list of text rather than searching for it. A list whose
+// queue reaches half its length is purged here, which keeps removals
+// amortised O(log n) and bounds the memory dead entries hold.
+void trigram_remove(TrigramIndex *ti, const char *text, int id) {
+    uint32_t grams[MAX_GRAMS];
+    size_t n = extract_grams(text, grams);
+    for (size_t i = 0; i < n; i++) {
+        Posting *p = lookup(ti, grams[i], false);
+        if (!p) continue;
+        if (p->n_gone == p->gone_cap) {
+            size_t new_cap = p->gone_cap ? p->gone_cap * 2 : 4;
+            int *grown = realloc(p->gone, new_cap * sizeof *grown);
+            if (!grown) {
+                // Out of memory: purge what is queued, then remove directly
+                ensure_sorted(p);
+                size_t at = lower_bound(p, id);
+                if (at < p->count && p->ids[at] == id) {
+                    memmove(&p->ids[at], &p->ids[at + 1], (p->count - at - 1) * sizeof *p->ids);
+                    p->count--;
+                }
+                continue;
+            }
+            p->gone = grown;
+            p->gone_cap = new_cap;
+        }
+        p->gone[p->n_gone++] = id;
+        if (p->n_gone * 2 >= p->count) ensure_sorted(p);
+    }
+}
+
+bool trigram_candidates(TrigramIndex *ti, const char *needle, int **out, size_t *count) {
+    *out = NULL;
+    *count = 0;
+    uint32_t grams[MAX_GRAMS];
+    size_t n = extract_grams(needle, grams);
+    if (n == 0) return false;
+
+    Posting *lists[MAX_GRAMS];
+    size_t smallest = 0;
+    for (size_t i = 0; i < n; i++) {
+        lists[i] = lookup(ti, grams[i], false);
+        if (!lists[i]) return true; // Some trigram never occurs
+        pthread_mutex_lock(&sort_lock);
+        ensure_sorted(lists[i]);
+        pthread_mutex_unlock(&sort_lock);
+        if (lists[i]->count == 0) return true;
+        if (lists[i]->count < lists[smallest]->count) smallest = i;
+    }
+
+    int *ids = malloc(lists[smallest]->count * sizeof *ids);
+    if (!ids) return false;
+
+    // Probe the other lists for each id of the shortest one
+    size_t k = 0;
+    for (size_t j = 0; j < lists[smallest]->count; j++) {
+        int id = lists[smallest]->ids[j];
+        bool in_all = true;
+        for (size_t i = 0; i < n && in_all; i++) {
+            if (i == smallest) continue;
+            size_t at = lower_bound(lists[i], id);
+            in_all = at < lists[i]->count && lists[i]->ids[at] == id;
+        }
+        if (in_all) ids[k++] = id;
+    }
+    *out = ids;
+    *count = k;
+    return true;
+}
+
+size_t trigram_estimate(TrigramIndex *ti, const char *needle) {
+    uint32_t grams[MAX_GRAMS];
+    size_t n = extract_grams(needle, grams);
+    if (n == 0) return SIZE_MAX;
+    size_t best = SIZE_MAX;
+    pthread_mutex_lock(&sort_lock);    // Counts change when a query purges a list
+    for (size_t i = 0; i < n && best > 0; i++) {
+        Posting *p = lookup(ti, grams[i], false);
+        size_t count = p ? p->count : 0;
+        if (count < best) best = count;
+    }
+    pthread_mutex_unlock(&sort_lock);
+    return best;
+}
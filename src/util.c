@@ -4,6 +4,7 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <limits.h>
+#include <math.h>
 #include "util.h"
 
 // Helper function to convert ASCII character to lowercase without locale dependence
@@ -117,27 +118,6 @@ bool str_icontains(const char *hay, const char *needle) {
 //     return token_start; // Return last token
 // }
 
-// Helper function to find the next key position in the string
-char* find_next_key(char *p, const char **found_keyname) {
-    char *next_key_pos = NULL;
-    *found_keyname = NULL;
-
-    const char *keys[] = {"ID", "Name", "Programme", "Mark"};
-    size_t num_keys = sizeof(keys) / sizeof(keys[0]);
-
-    for (size_t i = 0; i<num_keys; i++) {
-        char *found_pos = (char*)str_icase_find(p, keys[i]);
-        if (found_pos && (next_key_pos == NULL || found_pos < next_key_pos)) {
-            if (found_pos == p || isspace((unsigned char)*(found_pos - 1))) { // Ensure key is at start or preceded by space
-                next_key_pos = found_pos;
-                *found_keyname = (char*)keys[i];
-            }
-        }
-    }
-
-    return next_key_pos;
-}
-
 bool parse_int(const char *s, int *out) {
     if (!s || !out) return false;
     if (*s == '\0') return false; // Empty string check
@@ -183,5 +163,47 @@ bool valid_mark(float m) {
 bool valid_text(const char *s) {
     if (!s) return false;
     size_t len = strlen(s);
-    return len > 0 && len < 64; // Non-empty and within length check
-}
\ No newline at end of file
+    // Non-empty, within length, and no tab to break the TSV database
+    return len > 0 && len < 64 && !strchr(s, '\t');
+}
+
+size_t fmt_int(char *dst, int v) {
+    char tmp[12];
+    size_t n = 0;
+    unsigned u = v < 0 ? 0u - (unsigned)v : (unsigned)v;
+    do {
+        tmp[n++] = (char)('0' + u % 10);
+        u /= 10;
+    } while (u);
+    size_t len = 0;
+    if (v < 0) dst[len++] = '-';
+    while (n) dst[len++] = tmp[--n];
+    return len;
+}
+
+size_t fmt_mark(char *dst, float m) {
+    double scaled = (double)m * 10.0;  // Exact: a float times 10 fits in a double
+    if (!(scaled > -1e15 && scaled < 1e15)) {
+        return (size_t)snprintf(dst, 24, "%.1f", m);
+    }
+    size_t len = 0;
+    if (signbit(m)) {
+        dst[len++] = '-';
+        scaled = -scaled;
+    }
+    // Round half to even, as printf does for an exactly representable tie
+    long long t = (long long)scaled;
+    double frac = scaled - (double)t;
+    if (frac > 0.5 || (frac == 0.5 && (t & 1))) t++;
+    char digits[24];
+    size_t n = 0;
+    long long whole = t / 10;
+    do {
+        digits[n++] = (char)('0' + whole % 10);
+        whole /= 10;
+    } while (whole);
+    while (n) dst[len++] = digits[--n];
+    dst[len++] = '.';
+    dst[len++] = (char)('0' + t % 10);
+    return len;
+}
@@ -0,0 +1,178 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "version.h"
+
+void version_domain_init(VersionDomain *d) {
+    d->current = NULL;
+    d->generation = 0;
+    for (size_t i = 0; i < VERSION_MAX_READERS; i++) {
+        atomic_init(&d->readers[i], 0);
+    }
+    pthread_mutex_init(&d->publish_mu, NULL);
+    d->retired = NULL;
+    d->n_retired = 0;
+    d->retired_cap = 0;
+}
+
+static void version_free(StoreVersion *v) {
+    if (!v) return;
+    for (size_t b = 0; b < v->n_chunks; b++) {
+        free(v->chunks[b]);
+    }
+    free(v->chunks);
+    free(v);
+}
+
+void version_domain_free(VersionDomain *d) {
+    version_free(d->current);
+    for (size_t i = 0; i < d->n_retired; i++) {
+        free(d->retired[i].ptr);
+    }
+    free(d->retired);
+    pthread_mutex_destroy(&d->publish_mu);
+    d->current = NULL;
+    d->retired = NULL;
+    d->n_retired = d->retired_cap = 0;
+}
+
+// Copy block b of s into a chunk sized for the block's names
+static VersionChunk *chunk_new(const Store *s, size_t b) {
+    size_t first = b * STORE_BLOCK_ROWS;
+    size_t rows = s->size - first < STORE_BLOCK_ROWS ? s->size - first : STORE_BLOCK_ROWS;
+    size_t text = 0;
+    for (size_t i = 0; i < rows; i++) {
+        text += strlen(store_name(s, first + i)) + 1;
+    }
+    VersionChunk *c = malloc(sizeof *c + text);
+    if (!c) return NULL;
+
+    memcpy(c->ids, s->ids + first, rows * sizeof *c->ids);
+    memcpy(c->marks, s->marks + first, rows * sizeof *c->marks);
+    memcpy(c->progs, s->progs + first, rows * sizeof *c->progs);
+    size_t len = 0;
+    for (size_t i = 0; i < rows; i++) {
+        const char *name = store_name(s, first + i);
+        size_t n = strlen(name) + 1;
+        memcpy(c->names + len, name, n);
+        c->name_off[i] = (uint32_t)len;
+        len += n;
+    }
+    return c;
+}
+
+static void retire(VersionDomain *d, void *ptr, uint64_t epoch) {
+    d->retired[d->n_retired].ptr = ptr;
+    d->retired[d->n_retired].epoch = epoch;
+    d->n_retired++;
+}
+
+// Free what no pinned reader can reach: memory retired at epoch e is only
+// reachable from versions older than e
+static void reclaim(VersionDomain *d) {
+    uint64_t oldest = UINT64_MAX;
+    for (size_t i = 0; i < VERSION_MAX_READERS; i++) {
+        uint64_t e = atomic_load(&d->readers[i]);
+        if (e != 0 && e < oldest) oldest = e;
+    }
+    size_t kept = 0;
+    for (size_t i = 0; i < d->n_retired; i++) {
+        if (d->retired[i].epoch <= oldest) {
+            free(d->retired[i].ptr);
+        } else {
+            d->retired[kept++] = d->retired[i];
+        }
+    }
+    d->n_retired = kept;
+}
+
+// Build a version of s that shares the chunks of blocks untouched since cur
+static bool publish(VersionDomain *d, Store *s) {
+    StoreVersion *cur = d->current;
+    size_t n_chunks = (s->size + STORE_BLOCK_ROWS - 1) / STORE_BLOCK_ROWS;
+
+    // Room to retire everything cur holds, so a publish never fails halfway
+    size_t need = d->n_retired + (cur ? cur->n_chunks + 2 : 0);
+    if (need > d->retired_cap) {
+        size_t new_cap = d->retired_cap ? d->retired_cap * 2 : 64;
+        while (new_cap < need) new_cap *= 2;
+        VersionRetired *grown = realloc(d->retired, new_cap * sizeof *grown);
+        if (!grown) return false;
+        d->retired = grown;
+        d->retired_cap = new_cap;
+    }
+
+    StoreVersion *v = malloc(sizeof *v);
+    VersionChunk **chunks = calloc(n_chunks ? n_chunks : 1, sizeof *chunks);
+    if (!v || !chunks) {
+        free(v);
+        free(chunks);
+        return false;
+    }
+    for (size_t b = 0; b < n_chunks; b++) {
+        if (cur && b < cur->n_chunks && !store_block_touched(s, b)) {
+            chunks[b] = cur->chunks[b];
+            continue;
+        }
+        chunks[b] = chunk_new(s, b);
+        if (!chunks[b]) {
+            for (size_t i = 0; i < b; i++) {
+                if (!cur || i >= cur->n_chunks || chunks[i] != cur->chunks[i]) free(chunks[i]);
+            }
+            free(chunks);
+            free(v);
+            return false;
+        }
+    }
+
+    v->epoch = cur ? cur->epoch + 1 : 1;
+    v->size = s->size;
+    v->cap = s->cap;
+    v->widths = s->widths;
+    v->n_chunks = n_chunks;
+    v->chunks = chunks;
+
+    if (cur) {
+        for (size_t b = 0; b < cur->n_chunks; b++) {
+            if (b >= n_chunks || chunks[b] != cur->chunks[b]) retire(d, cur->chunks[b], v->epoch);
+        }
+        retire(d, cur->chunks, v->epoch);
+        retire(d, cur, v->epoch);
+    }
+    d->current = v;
+    d->generation = s->generation;
+    store_clear_touched(s);
+    reclaim(d);
+    return true;
+}
+
+bool version_pin(VersionDomain *d, Store *s, VersionPin *pin) {
+    pthread_mutex_lock(&d->publish_mu);
+    bool ok = true;
+    if (!d->current || s->touched_all || s->generation != d->generation) {
+        ok = publish(d, s);
+    }
+
+    // Announce under the lock, so the version cannot be retired before the
+    // announcement is visible to the next publish
+    size_t slot = VERSION_MAX_READERS;
+    for (size_t i = 0; ok && i < VERSION_MAX_READERS; i++) {
+        uint64_t free_slot = 0;
+        if (atomic_compare_exchange_strong(&d->readers[i], &free_slot, d->current->epoch)) {
+            slot = i;
+            break;
+        }
+    }
+    if (ok && slot < VERSION_MAX_READERS) {
+        pin->d = d;
+        pin->v = d->current;
+        pin->slot = slot;
+    }
+    pthread_mutex_unlock(&d->publish_mu);
+    return ok && slot < VERSION_MAX_READERS;
+}
+
+void version_unpin(VersionPin *pin) {
+    atomic_store(&pin->d->readers[pin->slot], 0);
+    pin->v = NULL;
+}
@@ -0,0 +1,110 @@
+#include <stdlib.h>
+#include <string.h>
+#include "view.h"
+
+static int row_cmp(const SortView *v, ViewRow a, ViewRow b) {
+    if (v->key == SORT_BY_MARK && a.mark != b.mark) {
+        int c = a.mark < b.mark ? -1 : 1;
+        return v->asc ? c : -c;
+    }
+    int c = (a.id > b.id) - (a.id < b.id);
+    return (v->key == SORT_BY_ID && !v->asc) ? -c : c;
+}
+
+// First position whose row does not sort before r
+static size_t lower_bound(const SortView *v, ViewRow r) {
+    size_t lo = 0, hi = v->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (row_cmp(v, v->rows[mid], r) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static bool view_reserve(SortView *v, size_t need) {
+    if (need <= v->cap) return true;
+    size_t new_cap = v->cap ? v->cap : 64;
+    while (new_cap < need) new_cap *= 2;
+    ViewRow *grown = realloc(v->rows, new_cap * sizeof *grown);
+    if (!grown) return false;
+    v->rows = grown;
+    v->cap = new_cap;
+    return true;
+}
+
+// Sort by ID first so the stable mark pass leaves ties in ID order
+static bool view_rebuild(SortView *v, const Store *s) {
+    size_t n = s->size;
+    size_t *order = malloc((n ? n : 1) * sizeof *order);
+    if (!order || !view_reserve(v, n)) {
+        free(order);
+        return false;
+    }
+    bool ok = store_sort_order(s, SORT_BY_ID, v->key == SORT_BY_ID ? v->asc : true, order);
+    if (ok && v->key == SORT_BY_MARK) {
+        ok = store_sort_refine(s, SORT_BY_MARK, v->asc, order);
+    }
+    if (ok) {
+        for (size_t i = 0; i < n; i++) {
+            v->rows[i].mark = s->marks[order[i]];
+            v->rows[i].id = s->ids[order[i]];
+        }
+        v->count = n;
+    }
+    free(order);
+    return ok;
+}
+
+// Splice one logged key change into the rows; false if they are out of step
+static bool view_apply(SortView *v, const StoreChange *c) {
+    ViewRow r = { c->mark, c->id };
+    size_t pos = lower_bound(v, r);
+    if (c->added) {
+        if (!view_reserve(v, v->count + 1)) return false;
+        memmove(&v->rows[pos + 1], &v->rows[pos], (v->count - pos) * sizeof *v->rows);
+        v->rows[pos] = r;
+        v->count++;
+    } else {
+        if (pos == v->count || v->rows[pos].id != c->id) return false;
+        memmove(&v->rows[pos], &v->rows[pos + 1], (v->count - pos - 1) * sizeof *v->rows);
+        v->count--;
+    }
+    return true;
+}
+
+static bool view_refresh(SortView *v, const Store *s) {
+    if (v->built && v->generation == s->generation) {
+        return true;
+    }
+
+    // Replay the edits made since the last refresh while the ring still holds them
+    bool ok = v->built && v->log_seq >= s->log_floor && s->log_next - v->log_seq <= STORE_LOG_CAP;
+    for (uint64_t seq = v->log_seq; ok && seq < s->log_next; seq++) {
+        ok = view_apply(v, &s->log[seq % STORE_LOG_CAP]);
+    }
+    if (!ok || v->count != s->size) {
+        v->built = false;
+        if (!view_rebuild(v, s)) return false;
+    }
+    v->built = true;
+    v->generation = s->generation;
+    v->log_seq = s->log_next;
+    return true;
+}
+
+void view_cache_reset(SortViewCache *c) {
+    for (int k = 0; k < 2; k++) {
+        for (int a = 0; a < 2; a++) {
+            free(c->views[k][a].rows);
+        }
+    }
+    memset(c, 0, sizeof *c);
+}
+
+const SortView *view_cache_get(SortViewCache *c, const Store *s, SortKey key, bool asc) {
+    SortView *v = &c->views[key][asc];
+    v->key = key;
+    v->asc = asc;
+    return view_refresh(v, s) ? v : NULL;
+}